@@ -0,0 +1,241 @@
+// Microbenchmarks for the calculators, the backtest and the CSV parser.
+//
+// Every benchmark runs on synthetic returns drawn with a fixed seed, over
+// series sizes from 10^3 up to --max-size, and prints one JSON object per
+// (benchmark, size) line so results can be diffed between releases:
+//
+//   {"benchmark":"HistoricalVaR","size":100000,"iterations":25,"mean_us":...,
+//    "p50_us":...,"p90_us":...,"p99_us":...,"items_per_second":...,
+//    "allocations":...,"allocated_bytes":...}
+//
+// Allocation figures are per iteration, counted by the global operator new
+// in allocation_hook.cpp with allocation tracking switched on.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "backtesting.h"
+#include "csv_parser.h"
+#include "cornish_fisher_var.h"
+#include "delta_var.h"
+#include "evt_var.h"
+#include "filtered_historical_var.h"
+#include "historical_var.h"
+#include "kernel_var.h"
+#include "monte_carlo_var.h"
+#include "parametric_var.h"
+#include "profiler.h"
+#include "simulation_engine.h"
+#include "stream_monitor.h"
+
+namespace {
+
+const uint64_t DATA_SEED = 20240101;
+const double CONFIDENCE = 0.99;
+const size_t MAX_SERIES = 100000000;
+
+struct BenchOptions {
+    size_t minSize = 1000;
+    size_t maxSize = 1000000;
+    size_t minIterations = 3;
+    size_t maxIterations = 1000;
+    double timeBudget = 0.5;    // Seconds per (benchmark, size)
+    unsigned threads = 0;
+    std::string filter;
+};
+
+// Runs fn until both the iteration minimum and the time budget are met and
+// prints the JSON record
+void runBenchmark(const BenchOptions& options, const std::string& name, size_t size,
+                  const std::function<void()>& fn) {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+        return;
+    }
+
+    LatencyRecorder latency;
+    size_t allocations = 0;
+    size_t bytes = 0;
+    double total = 0.0;
+
+    while (latency.count() < options.maxIterations
+           && (latency.count() < options.minIterations || total < options.timeBudget)) {
+        uint64_t countBefore = Profiler::allocationCount();
+        uint64_t bytesBefore = Profiler::allocatedBytes();
+        auto start = std::chrono::steady_clock::now();
+
+        fn();
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        allocations += Profiler::allocationCount() - countBefore;
+        bytes += Profiler::allocatedBytes() - bytesBefore;
+        latency.record(seconds * 1e6);
+        total += seconds;
+    }
+
+    size_t iterations = latency.count();
+    std::cout << std::fixed << std::setprecision(3)
+              << "{\"benchmark\":\"" << name << "\",\"size\":" << size
+              << ",\"iterations\":" << iterations
+              << ",\"mean_us\":" << total * 1e6 / iterations
+              << ",\"p50_us\":" << latency.percentile(50)
+              << ",\"p90_us\":" << latency.percentile(90)
+              << ",\"p99_us\":" << latency.percentile(99)
+              << ",\"items_per_second\":" << std::setprecision(0) << size * iterations / total
+              << ",\"allocations\":" << allocations / iterations
+              << ",\"allocated_bytes\":" << bytes / iterations << "}" << std::endl;
+}
+
+void benchCalculators(const BenchOptions& options, const std::vector<double>& returns) {
+    std::vector<std::pair<std::string, std::unique_ptr<VarCalculator>>> calculators;
+    calculators.emplace_back("HistoricalVaR", std::make_unique<HistoricalVaR>());
+    calculators.emplace_back("FilteredHistoricalVaR", std::make_unique<FilteredHistoricalVaR>());
+    calculators.emplace_back("ParametricVaR", std::make_unique<ParametricVaR>());
+    calculators.emplace_back("CornishFisherVaR", std::make_unique<CornishFisherVaR>());
+    calculators.emplace_back("DeltaVaR", std::make_unique<DeltaVaR>());
+    calculators.emplace_back("MonteCarloVaR", std::make_unique<MonteCarloVaR>(
+        10000, MonteCarloVaR::DEFAULT_SEED, options.threads));
+    calculators.emplace_back("EvtVaR", std::make_unique<EvtVaR>());
+    calculators.emplace_back("KernelVaR/exact", std::make_unique<KernelVaR>(-1.0, KdeCdf::Mode::Exact));
+    calculators.emplace_back("KernelVaR/binned", std::make_unique<KernelVaR>(-1.0, KdeCdf::Mode::Binned));
+    calculators.emplace_back("KernelVaR/binned-sj", std::make_unique<KernelVaR>(
+        BandwidthSelector::Rule::SheatherJones, KdeCdf::Mode::Binned));
+    calculators.emplace_back("KernelVaR/binned-lscv", std::make_unique<KernelVaR>(
+        BandwidthSelector::Rule::Lscv, KdeCdf::Mode::Binned));
+
+    for (auto& [name, calculator] : calculators) {
+        runBenchmark(options, name, returns.size(), [&]() {
+            volatile double sink = calculator->calculateRisk(returns, CONFIDENCE).var;
+            (void)sink;
+        });
+    }
+}
+
+// Cold GARCH fits of the series cut into 1000-return instruments
+void benchGarch(const BenchOptions& options, const std::vector<double>& returns) {
+    const size_t length = 1000;
+    std::vector<std::vector<double>> series;
+    for (size_t start = 0; start + length <= returns.size(); start += length) {
+        series.emplace_back(returns.begin() + start, returns.begin() + start + length);
+    }
+
+    runBenchmark(options, "Garch11::fitBatch", returns.size(), [&]() {
+        volatile size_t sink = Garch11::fitBatch(series, {}, options.threads).size();
+        (void)sink;
+    });
+}
+
+void benchBacktest(const BenchOptions& options, const std::vector<double>& returns) {
+    runBenchmark(options, "Backtesting::performBacktest", returns.size(), [&]() {
+        volatile int sink = Backtesting::performBacktest(returns, 0.023, 0.027, CONFIDENCE).exceeds;
+        (void)sink;
+    });
+}
+
+void benchParser(const BenchOptions& options, const std::vector<double>& returns) {
+    if (!options.filter.empty() && std::string("CSVParser::parseReturns").find(options.filter) == std::string::npos) {
+        return;
+    }
+
+    const std::string path = "var_bench_returns.csv";
+    {
+        std::ofstream file(path);
+        file << "date,returns,price\n";
+        file << std::setprecision(10);
+        double price = 100.0;
+        for (double r : returns) {
+            price *= 1.0 + r;
+            file << "2024-01-01," << r << ',' << price << '\n';
+        }
+    }
+
+    runBenchmark(options, "CSVParser::parseReturns", returns.size(), [&]() {
+        volatile size_t sink = CSVParser::parseReturns(path, "returns", options.threads).size();
+        (void)sink;
+    });
+
+    std::remove(path.c_str());
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options]\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  --min-size <n>          Smallest series (default: 1000)\n";
+    std::cout << "  --max-size <n>          Largest series, up to 1e8 (default: 1000000)\n";
+    std::cout << "  --min-iterations <n>    Minimum iterations per benchmark, at least 1 (default: 3)\n";
+    std::cout << "  --time <seconds>        Time budget per benchmark and size (default: 0.5)\n";
+    std::cout << "  --threads <n>           Worker threads for Monte Carlo and parsing (default: all cores)\n";
+    std::cout << "  --filter <text>         Only run benchmarks whose name contains text\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg == "--min-size" && i + 1 < argc) {
+            options.minSize = static_cast<size_t>(std::stod(argv[++i]));
+        } else if (arg == "--max-size" && i + 1 < argc) {
+            options.maxSize = static_cast<size_t>(std::stod(argv[++i]));
+        } else if (arg == "--min-iterations" && i + 1 < argc) {
+            options.minIterations = std::stoul(argv[++i]);
+        } else if (arg == "--time" && i + 1 < argc) {
+            options.timeBudget = std::stod(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    std::string invalid;
+    if (options.minSize == 0) {
+        invalid = "--min-size must be at least 1";
+    } else if (options.maxSize > MAX_SERIES) {
+        invalid = "--max-size must be at most 1e8";
+    } else if (options.minSize > options.maxSize) {
+        invalid = "--min-size must not exceed --max-size";
+    } else if (options.minIterations == 0) {
+        invalid = "--min-iterations must be at least 1";
+    }
+    if (!invalid.empty()) {
+        std::cerr << "Error: " << invalid << "\n";
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Stage timers stay off so they do not perturb the timings
+    Profiler::setAllocationTracking(true);
+
+    try {
+        SimulationEngine engine(DATA_SEED, options.threads);
+
+        for (size_t size = options.minSize; size <= options.maxSize; size *= 10) {
+            // Daily-like returns; the same series for every benchmark of a size
+            std::vector<double> returns = engine.simulateNormal(0.0003, 0.01, size);
+
+            benchCalculators(options, returns);
+            benchGarch(options, returns);
+            benchBacktest(options, returns);
+            benchParser(options, returns);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
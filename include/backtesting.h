@@ -3,7 +3,10 @@
 
 #include <vector>
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
+class VarCalculator;
 
 struct BacktestingResult {
     double var;
@@ -17,6 +20,53 @@ struct BacktestingResult {
     double accuracy;         
 };
 
+// Likelihood-ratio coverage test: statistic, its chi-squared p-value and
+// degrees of freedom
+struct CoverageTest {
+    double statistic = 0.0;
+    double pValue = 1.0;
+    int degreesOfFreedom = 1;
+    
+    bool rejected(double significance = 0.05) const { return pValue < significance; }
+};
+
+// Out-of-sample backtest: entry i is the forecast made from returns
+// [i, i + window) and the return of the following date it is tested on
+struct WalkForwardResult {
+    size_t window = 0;
+    double confidence = 0.0;
+    std::vector<double> var;
+    std::vector<double> es;
+    std::vector<double> realized;
+    std::vector<uint8_t> hits;          // 1 where realized < -var
+    
+    size_t exceedances = 0;
+    double exceedanceRate = 0.0;
+    
+    CoverageTest kupiec;                // Unconditional coverage (POF)
+    CoverageTest independence;          // Christoffersen first-order Markov
+    CoverageTest conditionalCoverage;   // Sum of both, 2 degrees of freedom
+};
+
+// Exceedances of a methods x levels matrix of VaR thresholds over one
+// return series. Each threshold also keeps a bitmap of the dates it was
+// breached on, for clustering analysis.
+struct ExceedanceMatrix {
+    size_t methods = 0;
+    size_t levels = 0;
+    size_t observations = 0;
+    size_t words = 0;                   // 64-bit words per bitmap
+    std::vector<size_t> counts;         // counts[method * levels + level]
+    std::vector<uint64_t> bitmaps;      // Bit i of bitmap k set if return i < -threshold k
+    
+    size_t count(size_t method, size_t level) const { return counts[method * levels + level]; }
+    double rate(size_t method, size_t level) const;
+    bool exceeded(size_t method, size_t level, size_t i) const;
+    
+    // Bitmap of one threshold as 0/1 flags, e.g. for independenceTest
+    std::vector<uint8_t> hits(size_t method, size_t level) const;
+};
+
 class Backtesting {
 public:
     static BacktestingResult performBacktest(const std::vector<double>& returns,
@@ -31,6 +81,32 @@ public:
     static double calculateAccuracyScore(double empiricalRate, double expectedRate);
     
     static std::string formatBacktestResults(const BacktestingResult& result);
+    
+    // Counts exceedances of every threshold[method][level] in one blocked
+    // pass over the returns: each block of 64 returns stays in cache while
+    // all thresholds are compared against it with SIMD compares and
+    // popcounts. Rows must all have the same length.
+    static ExceedanceMatrix countExceedances(const std::vector<double>& returns,
+                                             const std::vector<std::vector<double>>& thresholds);
+    
+    // Re-estimates the calculator on a rolling window at every date and
+    // tests each forecast on the next return. Windows are independent, so
+    // they are spread over numThreads workers (0 = all cores), each with its
+    // own clone of the calculator.
+    static WalkForwardResult walkForward(const VarCalculator& calculator,
+                                         const std::vector<double>& returns,
+                                         size_t window,
+                                         double confidence,
+                                         unsigned numThreads = 0);
+    
+    // Kupiec proportion-of-failures test of `exceedances` in `observations`
+    // against the expected rate alpha
+    static CoverageTest kupiecTest(size_t observations, size_t exceedances, double alpha);
+    
+    // Christoffersen test that exceedances do not cluster
+    static CoverageTest independenceTest(const std::vector<uint8_t>& hits);
+    
+    static std::string formatWalkForwardResults(const WalkForwardResult& result);
 };
 
 #endif // BACKTESTING_H
@@ -0,0 +1,39 @@
+#ifndef BANDWIDTH_SELECTOR_H
+#define BANDWIDTH_SELECTOR_H
+
+#include "return_series.h"
+#include <string>
+#include <cstddef>
+
+// Data-driven bandwidths for the Gaussian kernel density estimate.
+//
+// Silverman's rule assumes a normal shape and oversmooths fat tails. The
+// Sheather-Jones plug-in (the two-stage direct form of Wand and Jones) and
+// least-squares cross-validation estimate the density functionals they
+// need from the data instead. Every such estimate is a double sum of a
+// kernel over all pairs of points; linearly binning the sample onto a grid
+// of G points and taking the autocorrelation of the bin counts once by FFT
+// turns each of them into an O(G) sum over grid lags, so a selection costs
+// O(n + G log G) rather than O(n^2).
+class BandwidthSelector {
+public:
+    enum class Rule { Silverman, SheatherJones, Lscv };
+
+    static constexpr size_t DEFAULT_GRID = 4096;
+
+    // Bandwidth of a rule on the default grid. The series caches it, so
+    // each rule is evaluated at most once per series.
+    static double select(const ReturnSeries& returns, Rule rule);
+
+    static double sheatherJones(const ReturnSeries& returns, size_t gridSize = DEFAULT_GRID);
+
+    // Minimiser of the LSCV score over [h_os / 50, h_os], h_os being
+    // Terrell's oversmoothed bandwidth; the search stays a few grid steps
+    // above zero, where rounded prices would drive the score to -infinity
+    static double leastSquaresCv(const ReturnSeries& returns, size_t gridSize = DEFAULT_GRID);
+
+    // "silverman", "sj" or "lscv"; false for anything else
+    static bool parseRule(const std::string& name, Rule& rule);
+};
+
+#endif // BANDWIDTH_SELECTOR_H
@@ -0,0 +1,30 @@
+#ifndef CORNISH_FISHER_VAR_H
+#define CORNISH_FISHER_VAR_H
+
+#include "var_calculator.h"
+#include "higher_moments.h"
+
+// Modified VaR: the normal quantile corrected for sample skewness S and
+// excess kurtosis K by the Cornish-Fisher expansion
+//   z_cf = z + (z^2 - 1) S/6 + (z^3 - 3z) K/24 - (2z^3 - 5z) S^2/36.
+// ES averages the same expansion over the tail, which is closed-form in the
+// truncated normal moments (Boudt, Peterson & Croux, 2008). The expansion
+// is only monotone for moderate S and K.
+class CornishFisherVaR : public VarCalculator {
+public:
+    double calculateVaR(const ReturnSeries& returns, double confidence) override;
+    double calculateES(const ReturnSeries& returns, double confidence) override;
+    RiskMeasures calculateRisk(const ReturnSeries& returns, double confidence) override;
+    std::vector<RiskMeasures> calculateRiskBatch(const ReturnSeries& returns,
+                                                 const std::vector<double>& confidences) override;
+    std::string getMethodName() const override { return "Cornish-Fisher VaR"; }
+    std::unique_ptr<VarCalculator> clone() const override { return std::make_unique<CornishFisherVaR>(*this); }
+    
+    // VaR and ES from precomputed moments
+    static RiskMeasures fromMoments(const HigherMoments& moments, double confidence);
+    
+    // Adjusted lower-tail quantile of a standardised return
+    static double adjustedQuantile(double z, double skewness, double excessKurtosis);
+};
+
+#endif // CORNISH_FISHER_VAR_H
@@ -0,0 +1,33 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+// SIMD code paths are compiled with per-function target attributes, so a
+// single binary carries every variant and picks one at runtime.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VAR_X86_SIMD 1
+#else
+#define VAR_X86_SIMD 0
+#endif
+
+class CpuFeatures {
+public:
+    static bool hasAvx2() {
+#if VAR_X86_SIMD
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+#else
+        return false;
+#endif
+    }
+    
+    static bool hasAvx512() {
+#if VAR_X86_SIMD
+        static const bool supported = __builtin_cpu_supports("avx512f");
+        return supported;
+#else
+        return false;
+#endif
+    }
+};
+
+#endif // CPU_FEATURES_H
@@ -2,17 +2,64 @@
 #define CSV_PARSER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 
+// Numeric columns of a CSV file, stored contiguously by position in the
+// requested projection: columns[i] holds the values of names[i].
+struct CSVTable {
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns;
+
+    // Position of a column; throws if it was not loaded
+    size_t indexOf(const std::string& name) const;
+
+    std::vector<double>& column(const std::string& name) { return columns[indexOf(name)]; }
+    const std::vector<double>& column(const std::string& name) const { return columns[indexOf(name)]; }
+};
+
+// CSV reader for numeric columns. The file is memory-mapped and scanned in
+// place: fields are string_views into the mapping and numbers are parsed
+// with std::from_chars, so no field is ever copied into a string. Large
+// files are split at line boundaries and parsed on several threads.
 class CSVParser {
 public:
-    static std::map<std::string, std::vector<double>> parseCSV(const std::string& filename, bool hasHeader = true);
-    
-    static std::vector<double> parseReturns(const std::string& filename, const std::string& columnName = "returns");
+    // numThreads = 0 uses every hardware thread
+    static std::map<std::string, std::vector<double>> parseCSV(const std::string& filename, bool hasHeader = true,
+                                                               unsigned numThreads = 0);
+
+    // Loads only the named columns of a file with a header. Other fields are
+    // skipped without being converted, so cost grows with the projection,
+    // not with the width of the file. Throws if a column is missing.
+    static CSVTable parseColumns(const std::string& filename, const std::vector<std::string>& columns,
+                                 unsigned numThreads = 0);
+
+    static std::vector<double> parseReturns(const std::string& filename, const std::string& columnName = "returns",
+                                            unsigned numThreads = 0);
 
     private:
-    static std::vector<std::string> splitLine(const std::string& line, char delimiter = ',');
+    // Smallest chunk worth a thread of its own
+    static constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+    // Marks a field that is not part of the projection
+    static constexpr size_t SKIPPED = static_cast<size_t>(-1);
+
+    // Parses the lines of body into numSlots columns, field i feeding
+    // columns[slotOf[i]]. Lines whose field count differs from slotOf.size()
+    // are dropped. Without a header (slotOf empty) every field i is kept in
+    // column i and the table grows to the widest line.
+    static std::vector<std::vector<double>> parseBody(std::string_view body, const std::vector<size_t>& slotOf,
+                                                      size_t numSlots, bool hasHeader, unsigned numThreads);
+
+    // Trimmed fields of one line. A trailing delimiter does not start an
+    // empty last field, as with std::getline.
+    static void splitLine(std::string_view line, std::vector<std::string_view>& fields, char delimiter = ',');
+
+    static std::string_view trim(std::string_view field);
+
+    // std::stod semantics (leading number, anything after it ignored) without throwing
+    static bool parseNumber(std::string_view field, double& value);
 };
 
 #endif // CSV_PARSER_H
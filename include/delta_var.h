@@ -5,12 +5,10 @@
 
 class DeltaVaR : public VarCalculator {
 public:
-    double calculateVaR(const std::vector<double>& returns, double confidence) override;
-    double calculateES(const std::vector<double>& returns, double confidence) override;
+    double calculateVaR(const ReturnSeries& returns, double confidence) override;
+    double calculateES(const ReturnSeries& returns, double confidence) override;
     std::string getMethodName() const override { return "Delta-Normal VaR"; }
-
-private:
-    double getZScore(double confidence) const;
+    std::unique_ptr<VarCalculator> clone() const override { return std::make_unique<DeltaVaR>(*this); }
 };
 
 #endif // DELTA_VAR_H
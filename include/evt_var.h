@@ -0,0 +1,55 @@
+#ifndef EVT_VAR_H
+#define EVT_VAR_H
+
+#include "var_calculator.h"
+
+// Generalized Pareto fit to the losses above a threshold
+struct GpdFit {
+    double threshold = 0.0;     // Loss level u the exceedances are measured from
+    double scale = 0.0;         // sigma
+    double shape = 0.0;         // xi; > 0 is a heavy (Pareto-type) tail
+    size_t exceedances = 0;     // Losses above u
+    size_t observations = 0;    // Size of the whole sample
+};
+
+// Peaks-over-threshold VaR/ES (McNeil & Frey, 2000).
+//
+// The losses above a threshold are fitted with a Generalized Pareto
+// distribution by probability-weighted moments (Hosking & Wallis, 1987), and
+// VaR/ES follow in closed form, so extreme levels are extrapolated from the
+// shape of the tail instead of read off its few largest points.
+//
+// The threshold is chosen automatically among the top MAX_TAIL_FRACTION of
+// losses as the one whose fit is closest to its exceedances in
+// Kolmogorov-Smirnov distance (Clauset et al., 2009). Only that tail is
+// selected from the sample; the rest is never sorted.
+class EvtVaR : public VarCalculator {
+public:
+    static constexpr size_t MIN_EXCEEDANCES = 10;
+    static constexpr double MAX_TAIL_FRACTION = 0.10;
+    
+    double calculateVaR(const ReturnSeries& returns, double confidence) override;
+    double calculateES(const ReturnSeries& returns, double confidence) override;
+    RiskMeasures calculateRisk(const ReturnSeries& returns, double confidence) override;
+    std::vector<RiskMeasures> calculateRiskBatch(const ReturnSeries& returns,
+                                                 const std::vector<double>& confidences) override;
+    std::string getMethodName() const override { return "EVT (Peaks over Threshold)"; }
+    std::unique_ptr<VarCalculator> clone() const override { return std::make_unique<EvtVaR>(*this); }
+    
+    // Threshold choice and GPD fit. The threshold leaves more than
+    // minExceedances losses above it.
+    static GpdFit fitTail(const ReturnSeries& returns, size_t minExceedances = MIN_EXCEEDANCES);
+    
+    // GPD fit to the m largest losses, given the lowest m + 1 returns in
+    // ascending order and the sample size
+    static GpdFit fitExceedances(const std::vector<double>& tail, size_t m, size_t observations);
+    
+    // P(loss - u <= y | loss > u) under a fit
+    static double excessCdf(const GpdFit& fit, double y);
+    
+    // Closed-form tail measures of a fit; confidence must lie beyond the threshold
+    static double tailVaR(const GpdFit& fit, double confidence);
+    static double tailES(const GpdFit& fit, double confidence);
+};
+
+#endif // EVT_VAR_H
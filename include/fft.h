@@ -0,0 +1,20 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+#include <complex>
+
+// Radix-2 fast Fourier transform and the real-valued linear convolution
+// built on it. Used by the binned kernel density estimators.
+class FFT {
+public:
+    // In-place transform; the size of data must be a power of two.
+    static void transform(std::vector<std::complex<double>>& data, bool inverse = false);
+    
+    // Full linear convolution of a and b (size a.size() + b.size() - 1).
+    static std::vector<double> convolve(const std::vector<double>& a, const std::vector<double>& b);
+    
+    static size_t nextPowerOfTwo(size_t n);
+};
+
+#endif // FFT_H
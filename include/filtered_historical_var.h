@@ -0,0 +1,44 @@
+#ifndef FILTERED_HISTORICAL_VAR_H
+#define FILTERED_HISTORICAL_VAR_H
+
+#include "var_calculator.h"
+#include "garch.h"
+#include "historical_var.h"
+
+// Filtered historical simulation (Barone-Adesi et al.): the returns are
+// standardised by their fitted GARCH(1,1) volatility, rescaled by the
+// one-step-ahead volatility, and VaR/ES are read off that scenario set as
+// in HistoricalVaR. Unlike plain historical simulation the estimate follows
+// the current volatility regime.
+class FilteredHistoricalVaR : public VarCalculator {
+public:
+    // Each estimate fits GARCH(1,1) from the default starting point, so it
+    // depends on nothing but the series given
+    FilteredHistoricalVaR();
+    
+    // Every fit starts from these parameters instead, e.g. the previous
+    // day's fit of the same instrument. The start stays fixed: no call
+    // feeds its fit into the next one.
+    explicit FilteredHistoricalVaR(const GarchParams& start);
+    
+    double calculateVaR(const ReturnSeries& returns, double confidence) override;
+    double calculateES(const ReturnSeries& returns, double confidence) override;
+    RiskMeasures calculateRisk(const ReturnSeries& returns, double confidence) override;
+    std::vector<RiskMeasures> calculateRiskBatch(const ReturnSeries& returns,
+                                                 const std::vector<double>& confidences) override;
+    std::string getMethodName() const override { return "Filtered Historical VaR"; }
+    std::unique_ptr<VarCalculator> clone() const override { return std::make_unique<FilteredHistoricalVaR>(*this); }
+    
+    // Model behind the estimate for this series
+    GarchFit fit(const std::vector<double>& returns) const;
+    
+    // Mean plus standardised residuals times the forecast volatility
+    static std::vector<double> scenarios(const std::vector<double>& returns, const GarchFit& fit);
+
+private:
+    bool hasStart_ = false;
+    GarchParams start_;
+    HistoricalVaR historical_;
+};
+
+#endif // FILTERED_HISTORICAL_VAR_H
@@ -0,0 +1,61 @@
+#ifndef GARCH_H
+#define GARCH_H
+
+#include <vector>
+#include <cstddef>
+
+// GARCH(1,1) variance recursion h[t] = omega + alpha*e[t-1]^2 + beta*h[t-1]
+struct GarchParams {
+    double omega = 0.0;
+    double alpha = 0.05;
+    double beta = 0.90;
+
+    double persistence() const { return alpha + beta; }
+
+    // Unconditional variance omega / (1 - alpha - beta)
+    double longRunVariance() const;
+};
+
+struct GarchFit {
+    GarchParams params;
+    double mean = 0.0;          // Sample mean removed before fitting
+    double logLikelihood = 0.0; // Gaussian, without the constant term
+    size_t iterations = 0;
+    bool converged = false;
+};
+
+// Gaussian quasi-maximum-likelihood fit of GARCH(1,1) to a return series.
+//
+// Residuals are the demeaned returns and the recursion starts from their
+// sample variance. The likelihood and its analytic gradient come from one
+// pass over the series; BFGS with a projected backtracking line search keeps
+// omega > 0, alpha, beta >= 0 and alpha + beta < 1. Starting from a nearby
+// solution (e.g. yesterday's fit of the same instrument) typically cuts the
+// iterations several-fold.
+class Garch11 {
+public:
+    static constexpr size_t MIN_OBSERVATIONS = 30;
+    static constexpr size_t MAX_ITERATIONS = 200;
+    static constexpr double MAX_PERSISTENCE = 0.9999;
+
+    static GarchFit fit(const std::vector<double>& returns);
+    static GarchFit fit(const std::vector<double>& returns, const GarchParams& start);
+
+    // Fits every series on up to numThreads workers (0 = all cores). starts
+    // is either empty or holds one warm start per series.
+    static std::vector<GarchFit> fitBatch(const std::vector<std::vector<double>>& series,
+                                          const std::vector<GarchParams>& starts = {},
+                                          unsigned numThreads = 0);
+
+    // Conditional variances of the demeaned series: n + 1 entries, the last
+    // one being the one-step-ahead forecast
+    static std::vector<double> conditionalVariance(const std::vector<double>& residuals,
+                                                   const GarchParams& params);
+
+    // Average negative log-likelihood per observation and, if gradient is
+    // non-null, its derivatives with respect to (omega, alpha, beta)
+    static double negativeLogLikelihood(const std::vector<double>& residuals, const GarchParams& params,
+                                        double* gradient = nullptr);
+};
+
+#endif // GARCH_H
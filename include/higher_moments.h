@@ -0,0 +1,43 @@
+#ifndef HIGHER_MOMENTS_H
+#define HIGHER_MOMENTS_H
+
+#include <vector>
+#include <cstddef>
+
+// Count, mean and central moments up to the fourth from one pass over the
+// data. Arrays are consumed in blocks: a SIMD kernel accumulates power sums
+// of each block around the running mean, and the block is folded in with
+// the pairwise update of Pebay (2008). The same update merges partial
+// results from different threads or chunks, in any grouping.
+class HigherMoments {
+public:
+    static constexpr size_t BLOCK_SIZE = 4096;
+    
+    void add(double x);
+    void add(const double* data, size_t n);
+    void merge(const HigherMoments& other);
+    
+    size_t count() const { return count_; }
+    double mean() const { return mean_; }
+    
+    // Sample variance (n - 1 denominator), 0 below two observations
+    double variance() const;
+    double stdDev() const;
+    
+    // Moment estimators m3 / m2^1.5 and m4 / m2^2 - 3, 0 without dispersion
+    double skewness() const;
+    double excessKurtosis() const;
+    
+    // Chunks of the data are summarised on up to numThreads workers (0 =
+    // all cores) and merged in order, so the result is deterministic
+    static HigherMoments of(const std::vector<double>& data, unsigned numThreads = 1);
+
+private:
+    size_t count_ = 0;
+    double mean_ = 0.0;
+    double m2_ = 0.0;   // Sums of powers of deviations from the mean
+    double m3_ = 0.0;
+    double m4_ = 0.0;
+};
+
+#endif // HIGHER_MOMENTS_H
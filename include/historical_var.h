@@ -5,9 +5,26 @@
 
 class HistoricalVaR : public VarCalculator {
 public:
-    double calculateVaR(const std::vector<double>& returns, double confidence) override;
-    double calculateES(const std::vector<double>& returns, double confidence) override;
+    double calculateVaR(const ReturnSeries& returns, double confidence) override;
+    double calculateES(const ReturnSeries& returns, double confidence) override;
+    RiskMeasures calculateRisk(const ReturnSeries& returns, double confidence) override;
+    std::vector<RiskMeasures> calculateRiskBatch(const ReturnSeries& returns,
+                                                 const std::vector<double>& confidences) override;
     std::string getMethodName() const override { return "Historical VaR"; }
+    std::unique_ptr<VarCalculator> clone() const override { return std::make_unique<HistoricalVaR>(*this); }
+    
+    // Fractional order-statistic index of the VaR quantile: the result
+    // interpolates linearly between floor() and ceil() of this position
+    static double quantilePosition(size_t n, double confidence);
+
+protected:
+    RiskMeasures calculateRiskInPlace(std::vector<double>& sample, double confidence) override;
+
+private:
+    // Linearly interpolated lower quantile; only the first
+    // quantileTailSize() elements of the sample need to be sorted
+    static double interpolatedQuantile(const std::vector<double>& sorted, double confidence);
+    static size_t quantileTailSize(size_t n, double confidence);
 };
 
 #endif // HISTORICAL_VAR_H
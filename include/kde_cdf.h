@@ -0,0 +1,68 @@
+#ifndef KDE_CDF_H
+#define KDE_CDF_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Cumulative distribution of a Gaussian kernel density estimate.
+//
+// Exact mode sorts the sample and sums the closed-form kernel CDF, only
+// visiting points within CUTOFF bandwidths of x, and inverts it with a
+// safeguarded Newton iteration. Binned mode linearly bins the sample onto a
+// grid and convolves it with the kernel CDF by FFT once, so every later
+// cdf/quantile query is a table lookup.
+class KdeCdf {
+public:
+    enum class Mode { Exact, Binned };
+    
+    // Kernel contributions beyond this many bandwidths are treated as 0 or 1
+    static constexpr double CUTOFF = 8.5;
+    
+    // The sample may be in any order; binned mode never sorts it
+    KdeCdf(std::vector<double> data, double bandwidth,
+           Mode mode = Mode::Exact, size_t gridSize = 4096);
+    
+    // "exact" or "binned"; false for anything else
+    static bool parseMode(const std::string& name, Mode& mode);
+    
+    double cdf(double x) const;
+    double pdf(double x) const;
+    double quantile(double probability) const;
+    
+    // Partial first moment E[X; X <= x] of the density, in closed form: each
+    // kernel contributes x_i Phi(u) - h phi(u) with u = (x - x_i) / h. Points
+    // more than CUTOFF bandwidths below x contribute x_i, points above
+    // nothing. Dividing by the tail probability gives the expected shortfall.
+    double partialMean(double x) const;
+    
+    Mode mode() const { return mode_; }
+    double bandwidth() const { return bandwidth_; }
+    const std::vector<double>& data() const { return data_; }
+
+private:
+    std::vector<double> data_;
+    double bandwidth_;
+    Mode mode_;
+    
+    // Sample minimum and maximum
+    double minValue_ = 0.0;
+    double maxValue_ = 0.0;
+    
+    // Binned mode tables
+    double gridStart_ = 0.0;
+    double gridStep_ = 0.0;
+    std::vector<double> cdfTable_;
+    
+    void buildTable(size_t gridSize);
+    
+    double exactCdf(double x) const;
+    double exactPdf(double x) const;
+    double exactQuantile(double probability) const;
+    
+    double tableCdf(double x) const;
+    double tablePdf(double x) const;
+    double tableQuantile(double probability) const;
+};
+
+#endif // KDE_CDF_H
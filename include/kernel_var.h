@@ -2,27 +2,41 @@
 #define KERNEL_VAR_H
 
 #include "var_calculator.h"
+#include "kde_cdf.h"
+#include "bandwidth_selector.h"
 
 class KernelVaR : public VarCalculator {
 public:
-    KernelVaR(double bandwidth = -1.0);
+    // A positive bandwidth is used as given; otherwise it is selected by rule
+    KernelVaR(double bandwidth = -1.0, KdeCdf::Mode mode = KdeCdf::Mode::Exact);
+    KernelVaR(BandwidthSelector::Rule rule, KdeCdf::Mode mode = KdeCdf::Mode::Exact);
     
-    double calculateVaR(const std::vector<double>& returns, double confidence) override;
-    double calculateES(const std::vector<double>& returns, double confidence) override;
+    double calculateVaR(const ReturnSeries& returns, double confidence) override;
+    double calculateES(const ReturnSeries& returns, double confidence) override;
+    RiskMeasures calculateRisk(const ReturnSeries& returns, double confidence) override;
+    std::vector<RiskMeasures> calculateRiskBatch(const ReturnSeries& returns,
+                                                 const std::vector<double>& confidences) override;
     std::string getMethodName() const override { return "Kernel Density VaR"; }
+    std::unique_ptr<VarCalculator> clone() const override { return std::make_unique<KernelVaR>(*this); }
     
     void setBandwidth(double h) { bandwidth_ = h; }
+    void setBandwidthRule(BandwidthSelector::Rule rule) { rule_ = rule; }
+    void setMode(KdeCdf::Mode mode) { mode_ = mode; }
 
 private:
     double bandwidth_;
+    BandwidthSelector::Rule rule_ = BandwidthSelector::Rule::Silverman;
+    KdeCdf::Mode mode_;
     
-    double gaussianKernel(double x) const;
+    double findQuantile(const KdeCdf& cdf, double confidence) const;
     
-    double estimatePDF(double x, const std::vector<double>& data, double h) const;
+    // VaR at the KDE quantile and the analytic ES below it
+    RiskMeasures riskAt(const KdeCdf& cdf, double confidence) const;
     
-    double calculateOptimalBandwidth(const std::vector<double>& data) const;
+    double resolveBandwidth(const ReturnSeries& returns) const;
     
-    double findQuantile(const std::vector<double>& sortedData, double bandwidth, double confidence) const;
+    // Sample handed to the KDE: sorted for the exact mode
+    const std::vector<double>& kdeSample(const ReturnSeries& returns) const;
 };
 
 #endif // KERNEL_VAR_H
@@ -0,0 +1,29 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// Read-only view of a whole file. On POSIX systems the file is mapped into
+// memory, so parsers can scan it in place without copying it into streams
+// or strings; elsewhere it falls back to reading the file into a buffer.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const { return std::string_view(data_, size_); }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::string buffer_;  // Only used when the file cannot be mapped
+    bool mapped_ = false;
+};
+
+#endif // MAPPED_FILE_H
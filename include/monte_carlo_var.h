@@ -2,21 +2,71 @@
 #define MONTE_CARLO_VAR_H
 
 #include "var_calculator.h"
+#include "simulation_engine.h"
+#include <cstdint>
+#include <utility>
 
 class MonteCarloVaR : public VarCalculator {
 public:
-    MonteCarloVaR(int numSimulations = 10000);
+    enum class SamplingMode {
+        PseudoRandom,       // Plain Philox normals
+        Antithetic,         // (z, -z) pairs
+        Sobol,              // Owen-scrambled Sobol + inverse normal transform
+        ImportanceSampling  // Mean shifted into the loss tail, likelihood-ratio weighted
+    };
     
-    double calculateVaR(const std::vector<double>& returns, double confidence) override;
-    double calculateES(const std::vector<double>& returns, double confidence) override;
+    static constexpr uint64_t DEFAULT_SEED = 42;
+    
+    // Independent replications used to estimate the standard errors
+    static constexpr size_t NUM_BATCHES = 32;
+    
+    // numThreads = 0 uses every hardware thread; results only depend on the seed
+    MonteCarloVaR(int numSimulations = 10000, uint64_t seed = DEFAULT_SEED, unsigned numThreads = 0,
+                  SamplingMode mode = SamplingMode::PseudoRandom);
+    
+    double calculateVaR(const ReturnSeries& returns, double confidence) override;
+    double calculateES(const ReturnSeries& returns, double confidence) override;
+    RiskMeasures calculateRisk(const ReturnSeries& returns, double confidence) override;
+    std::vector<RiskMeasures> calculateRiskBatch(const ReturnSeries& returns,
+                                                 const std::vector<double>& confidences) override;
     std::string getMethodName() const override { return "Monte Carlo VaR"; }
+    std::unique_ptr<VarCalculator> clone() const override { return std::make_unique<MonteCarloVaR>(*this); }
     
     void setNumSimulations(int n) { numSimulations_ = n; }
+    void setSeed(uint64_t seed) { engine_ = SimulationEngine(seed, engine_.numThreads(), engine_.backend()); }
+    void setNumThreads(unsigned n) { engine_ = SimulationEngine(engine_.seed(), n, engine_.backend()); }
+    void setSamplingMode(SamplingMode mode) { samplingMode_ = mode; }
+    
+    static const char* samplingModeName(SamplingMode mode);
+    
+    // Inverse of samplingModeName; false for any other name
+    static bool parseSamplingMode(const std::string& name, SamplingMode& mode);
 
 private:
     int numSimulations_;
+    SimulationEngine engine_;
+    SamplingMode samplingMode_;
     
     std::vector<double> simulateReturns(double mean, double stdDev, int n);
+    
+    // Paths per standard-error batch; even so antithetic pairs never straddle batches
+    size_t batchSize(size_t n) const;
+    
+    std::vector<RiskMeasures> importanceSamplingRisk(double mean, double stdDev,
+                                                     const std::vector<double>& confidences);
+    
+    // VaR/ES of an equally weighted sample at each level (reorders it)
+    static std::vector<RiskMeasures> sampleRisk(std::vector<double>& sample,
+                                                const std::vector<double>& confidences);
+    
+    // VaR/ES of (value, likelihood ratio) pairs at each level (sorts them)
+    static std::vector<RiskMeasures> weightedRisk(std::vector<std::pair<double, double>>& sample,
+                                                  const std::vector<double>& confidences);
+    static RiskMeasures weightedTail(const std::vector<std::pair<double, double>>& sorted, double confidence);
+    
+    // batches[b][level] -> standard errors of risks[level]
+    static void setStandardErrors(std::vector<RiskMeasures>& risks,
+                                  const std::vector<std::vector<RiskMeasures>>& batches);
 };
 
 #endif // MONTE_CARLO_VAR_H
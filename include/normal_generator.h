@@ -0,0 +1,31 @@
+#ifndef NORMAL_GENERATOR_H
+#define NORMAL_GENERATOR_H
+
+#include "philox.h"
+#include <cstddef>
+
+// Buffer-at-a-time Gaussian variate generator.
+//
+// Uniforms are drawn from a Philox stream in chunks and turned into normals
+// with the Box-Muller transform, using AVX-512 or AVX2 kernels when the CPU
+// supports them and a libm scalar loop otherwise. For a given backend the
+// output depends only on the generator state.
+class NormalGenerator {
+public:
+    enum class Backend { Scalar, Avx2, Avx512 };
+    
+    static Backend detectBackend();
+    static const char* backendName(Backend backend);
+    
+    explicit NormalGenerator(Backend backend = detectBackend());
+    
+    // Writes n draws of N(mean, stdDev^2) to out
+    void fill(Philox4x32& gen, double* out, size_t n, double mean = 0.0, double stdDev = 1.0) const;
+    
+    Backend backend() const { return backend_; }
+
+private:
+    Backend backend_;
+};
+
+#endif // NORMAL_GENERATOR_H
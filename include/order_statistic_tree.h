@@ -0,0 +1,58 @@
+#ifndef ORDER_STATISTIC_TREE_H
+#define ORDER_STATISTIC_TREE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Multiset of doubles with O(log n) insert, erase, k-th smallest and sum of
+// the k smallest values. Implemented as a treap whose nodes carry subtree
+// counts and sums; nodes live in a pool so a sliding window reuses them
+// instead of allocating.
+class OrderStatisticTree {
+public:
+    // NaN has no place in the order and is rejected
+    void insert(double value);
+    
+    // Removes one copy of value; returns false if it is not present
+    bool erase(double value);
+    
+    void clear();
+    
+    size_t size() const { return root_ < 0 ? 0 : nodes_[root_].size; }
+    bool empty() const { return size() == 0; }
+    
+    // k-th smallest value, 0-based (k < size())
+    double kth(size_t k) const;
+    
+    // Sum of the k smallest values (k <= size())
+    double sumSmallest(size_t k) const;
+
+private:
+    struct Node {
+        double key;
+        double sum;       // Sum over the subtree, duplicates included
+        uint32_t count;   // Copies of key stored in this node
+        uint32_t size;    // Values in the subtree, duplicates included
+        uint32_t priority;
+        int left;
+        int right;
+    };
+    
+    std::vector<Node> nodes_;
+    std::vector<int> freeNodes_;
+    int root_ = -1;
+    uint32_t rngState_ = 0x9E3779B9u;
+    
+    int newNode(double value);
+    void update(int t);
+    int rotateLeft(int t);
+    int rotateRight(int t);
+    int insert(int t, double value);
+    int erase(int t, double value, bool& removed);
+    
+    uint32_t subtreeSize(int t) const { return t < 0 ? 0 : nodes_[t].size; }
+    double subtreeSum(int t) const { return t < 0 ? 0.0 : nodes_[t].sum; }
+};
+
+#endif // ORDER_STATISTIC_TREE_H
@@ -0,0 +1,72 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal fork-join helper: runs fn(index, worker) for every index in
+// [0, count) on up to `threads` workers, handing indices out dynamically.
+// The first exception thrown by any worker is rethrown on the caller.
+class Parallel {
+public:
+    // 0 means "use every hardware thread"
+    static unsigned resolveThreads(unsigned requested) {
+        if (requested > 0) {
+            return requested;
+        }
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    template <typename Function>
+    static void forEach(size_t count, unsigned threads, Function&& fn) {
+        unsigned workers = static_cast<unsigned>(
+            std::min<size_t>(resolveThreads(threads), count));
+        
+        if (workers <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i, 0u);
+            }
+            return;
+        }
+        
+        std::atomic<size_t> next{0};
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        
+        auto work = [&](unsigned worker) {
+            try {
+                for (size_t i = next++; i < count; i = next++) {
+                    fn(i, worker);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = count;
+            }
+        };
+        
+        std::vector<std::thread> pool;
+        pool.reserve(workers - 1);
+        for (unsigned w = 1; w < workers; ++w) {
+            pool.emplace_back(work, w);
+        }
+        work(0);
+        
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+#endif // PARALLEL_H
@@ -5,12 +5,12 @@
 
 class ParametricVaR : public VarCalculator {
 public:
-    double calculateVaR(const std::vector<double>& returns, double confidence) override;
-    double calculateES(const std::vector<double>& returns, double confidence) override;
+    double calculateVaR(const ReturnSeries& returns, double confidence) override;
+    double calculateES(const ReturnSeries& returns, double confidence) override;
+    std::vector<RiskMeasures> calculateRiskBatch(const ReturnSeries& returns,
+                                                 const std::vector<double>& confidences) override;
     std::string getMethodName() const override { return "Parametric VaR (Normal)"; }
-
-private:
-    double getZScore(double confidence) const;
+    std::unique_ptr<VarCalculator> clone() const override { return std::make_unique<ParametricVaR>(*this); }
 };
 
 #endif // PARAMETRIC_VAR_H
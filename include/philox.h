@@ -0,0 +1,91 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+// Philox4x32-10 counter-based random number generator (Salmon et al., 2011).
+//
+// Every (seed, stream) pair selects an independent sequence and any position
+// can be reached without generating the values before it, so parallel work
+// can be split into fixed blocks whose output does not depend on which
+// thread generated them. Satisfies UniformRandomBitGenerator.
+class Philox4x32 {
+public:
+    using result_type = uint32_t;
+    
+    // Round multipliers and Weyl key increments
+    static constexpr uint32_t M0 = 0xD2511F53;
+    static constexpr uint32_t M1 = 0xCD9E8D57;
+    static constexpr uint32_t W0 = 0x9E3779B9;
+    static constexpr uint32_t W1 = 0xBB67AE85;
+    static constexpr int ROUNDS = 10;
+    
+    Philox4x32(uint64_t seed, uint64_t stream = 0)
+        : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+          counter_{0, 0, static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)},
+          index_(4) {}
+    
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+    
+    result_type operator()() {
+        if (index_ == 4) {
+            output_ = generateBlock(counter_, key_);
+            if (++counter_[0] == 0) {
+                ++counter_[1];
+            }
+            index_ = 0;
+        }
+        return output_[index_++];
+    }
+    
+    // Uniform double in [0, 1) with 53 random bits
+    double uniform() {
+        uint64_t hi = (*this)();
+        uint64_t lo = (*this)();
+        return static_cast<double>(((hi << 32) | lo) >> 11) * 0x1.0p-53;
+    }
+    
+    // Block-level state, for kernels that evaluate many blocks at once.
+    // Those kernels must start at a block boundary to stay in sequence.
+    bool atBlockBoundary() const { return index_ == 4; }
+    uint64_t blockPosition() const { return static_cast<uint64_t>(counter_[1]) << 32 | counter_[0]; }
+    uint64_t stream() const { return static_cast<uint64_t>(counter_[3]) << 32 | counter_[2]; }
+    uint32_t key(int word) const { return key_[word]; }
+    
+    // Skip ahead by a number of 4-word output blocks
+    void discardBlocks(uint64_t blocks) {
+        uint64_t position = blockPosition() + blocks;
+        counter_[0] = static_cast<uint32_t>(position);
+        counter_[1] = static_cast<uint32_t>(position >> 32);
+        index_ = 4;
+    }
+
+private:
+    using Block = std::array<uint32_t, 4>;
+    
+    std::array<uint32_t, 2> key_;
+    Block counter_;
+    Block output_{};
+    int index_;
+    
+    static Block generateBlock(Block ctr, std::array<uint32_t, 2> key) {
+        for (int round = 0; round < ROUNDS; ++round) {
+            uint64_t p0 = static_cast<uint64_t>(M0) * ctr[0];
+            uint64_t p1 = static_cast<uint64_t>(M1) * ctr[2];
+            
+            ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0],
+                   static_cast<uint32_t>(p1),
+                   static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1],
+                   static_cast<uint32_t>(p0)};
+            
+            key[0] += W0;
+            key[1] += W1;
+        }
+        return ctr;
+    }
+};
+
+#endif // PHILOX_H
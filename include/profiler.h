@@ -0,0 +1,111 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Process-wide stage timers and event counters for the hot paths.
+//
+// Instrumented code uses VAR_PROFILE_SCOPE("stage") and
+// VAR_PROFILE_COUNT("counter", n). While the profiler is disabled each of
+// them costs one relaxed atomic load and a branch; building with
+// -DVAR_PROFILING=0 removes them entirely. Stage times are inclusive and
+// summed over threads.
+//
+// Each call site registers its name once and keeps the slot it is given.
+// Updates go to the calling thread's own table without a lock, and
+// report() merges the tables, so profiling does not serialise the
+// parallel stages it measures.
+//
+// Allocations are counted only while allocation tracking is on, and only
+// in executables that link allocation_hook.cpp, whose global operator new
+// calls recordAllocation.
+#ifndef VAR_PROFILING
+#define VAR_PROFILING 1
+#endif
+
+class Profiler {
+public:
+    enum class Format { Table, Json };
+
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+    static bool trackingAllocations() { return trackAllocations_.load(std::memory_order_relaxed); }
+
+    // Enabling also turns allocation tracking on
+    static void setEnabled(bool on);
+    static void setAllocationTracking(bool on);
+
+    // Starts the stage and counter totals and the allocation counts over.
+    // Safe while other threads are recording: an update that races with
+    // it is counted on one side of the reset or the other.
+    static void reset();
+
+    // Stage and counter names must be string literals (they are stored by
+    // pointer). Call sites with the same name share a slot; at most
+    // MAX_SLOTS names can be registered.
+    static constexpr size_t MAX_SLOTS = 256;
+    static size_t stageSlot(const char* stage);
+    static size_t counterSlot(const char* counter);
+    
+    static void addTime(size_t slot, double seconds);
+    static void addCount(size_t slot, uint64_t n);
+
+    // Allocations made while tracking was on
+    static uint64_t allocationCount();
+    static uint64_t allocatedBytes();
+    static void recordAllocation(size_t bytes);
+
+    static std::string report(Format format = Format::Table);
+
+private:
+    static inline std::atomic<bool> enabled_{false};
+    static inline std::atomic<bool> trackAllocations_{false};
+};
+
+// Adds the lifetime of the scope to a stage while the profiler is enabled
+class ScopedTimer {
+public:
+    explicit ScopedTimer(size_t slot)
+        : slot_(slot), active_(Profiler::enabled()) {
+        if (active_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if (active_) {
+            Profiler::addTime(slot_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    size_t slot_;
+    bool active_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#if VAR_PROFILING
+#define VAR_PROFILE_CONCAT_(a, b) a##b
+#define VAR_PROFILE_CONCAT(a, b) VAR_PROFILE_CONCAT_(a, b)
+#define VAR_PROFILE_SCOPE(stage) \
+    static const size_t VAR_PROFILE_CONCAT(varProfileSlot, __LINE__) = Profiler::stageSlot(stage); \
+    ScopedTimer VAR_PROFILE_CONCAT(varProfileScope, __LINE__)(VAR_PROFILE_CONCAT(varProfileSlot, __LINE__))
+#define VAR_PROFILE_COUNT(counter, n) \
+    do { \
+        if (Profiler::enabled()) { \
+            static const size_t varProfileSlot = Profiler::counterSlot(counter); \
+            Profiler::addCount(varProfileSlot, static_cast<uint64_t>(n)); \
+        } \
+    } while (0)
+#else
+#define VAR_PROFILE_SCOPE(stage) do { } while (0)
+#define VAR_PROFILE_COUNT(counter, n) do { } while (0)
+#endif
+
+#endif // PROFILER_H
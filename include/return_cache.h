@@ -0,0 +1,74 @@
+#ifndef RETURN_CACHE_H
+#define RETURN_CACHE_H
+
+#include "csv_parser.h"
+#include "mapped_file.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Binary columnar cache of return series, so repeated runs skip CSV parsing.
+//
+// Layout (host byte order, checked on load):
+//   Header     magic "VARCACHE", version, byte-order mark, column count
+//   Directory  one entry per column: name, element type, offset, count
+//   Data       each column's values as a packed double or float array,
+//              starting on a 64-byte boundary
+//
+// Loading maps the file and hands out views straight into the mapping, so
+// opening a cache costs the same whatever the length of the history.
+class ReturnCache {
+public:
+    enum class ColumnType : uint32_t { Double = 0, Float = 1 };
+
+    // Zero-copy view of one cached column
+    struct ColumnView {
+        const void* data = nullptr;
+        size_t size = 0;
+        ColumnType type = ColumnType::Double;
+
+        double operator[](size_t i) const {
+            return type == ColumnType::Double ? static_cast<const double*>(data)[i]
+                                              : static_cast<const float*>(data)[i];
+        }
+
+        // Direct pointer for double columns, nullptr for float ones
+        const double* doubles() const {
+            return type == ColumnType::Double ? static_cast<const double*>(data) : nullptr;
+        }
+
+        std::vector<double> toVector() const;
+    };
+
+    static constexpr char MAGIC[8] = {'V', 'A', 'R', 'C', 'A', 'C', 'H', 'E'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t NAME_LENGTH = 64;
+    static constexpr size_t ALIGNMENT = 64;
+
+    explicit ReturnCache(const std::string& filename);
+
+    const std::vector<std::string>& names() const { return names_; }
+    bool hasColumn(const std::string& name) const;
+
+    // Throws if the column is not in the cache
+    ColumnView column(const std::string& name) const;
+
+    // Writes every column of table; values are narrowed if type is Float
+    static void write(const std::string& filename, const CSVTable& table, ColumnType type = ColumnType::Double);
+
+    // Parses the named columns of a CSV file and writes them as a cache
+    static void convert(const std::string& csvFile, const std::string& cacheFile,
+                        const std::vector<std::string>& columns, ColumnType type = ColumnType::Double,
+                        unsigned numThreads = 0);
+
+    // True if the file starts with the cache magic
+    static bool isCache(const std::string& filename);
+
+private:
+    std::unique_ptr<MappedFile> file_;
+    std::vector<std::string> names_;
+    std::vector<ColumnView> columns_;
+};
+
+#endif // RETURN_CACHE_H
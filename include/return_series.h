@@ -0,0 +1,75 @@
+#ifndef RETURN_SERIES_H
+#define RETURN_SERIES_H
+
+#include "higher_moments.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+
+// Return series as handed to the calculators, with the views several of
+// them derive from it: the sorted lower tail (or the full sort), the fused
+// moments and the kernel bandwidths chosen from the data. Each view is
+// built on first use, once even under concurrent calls, and then shared by
+// every calculator and every VaR/ES call that reads the same series.
+//
+// Converts implicitly from a vector, which it borrows (the vector must
+// outlive the series) or takes over when given an rvalue, and back to
+// const std::vector<double>& for code that needs the raw values.
+class ReturnSeries {
+public:
+    ReturnSeries(const std::vector<double>& returns) : values_(&returns) {}
+    ReturnSeries(std::vector<double>&& returns) : owned_(std::move(returns)), values_(&owned_) {}
+    
+    // The caches hold once_flags, and a borrowed series must not be duplicated
+    ReturnSeries(const ReturnSeries&) = delete;
+    ReturnSeries& operator=(const ReturnSeries&) = delete;
+    
+    const std::vector<double>& values() const { return *values_; }
+    operator const std::vector<double>&() const { return *values_; }
+    
+    size_t size() const { return values_->size(); }
+    bool empty() const { return values_->empty(); }
+    double operator[](size_t i) const { return (*values_)[i]; }
+    const double* data() const { return values_->data(); }
+    std::vector<double>::const_iterator begin() const { return values_->begin(); }
+    std::vector<double>::const_iterator end() const { return values_->end(); }
+    
+    // All returns in ascending order
+    const std::vector<double>& sorted() const;
+    
+    // All returns with (at least) the k smallest sorted at the front, the
+    // rest in unspecified order. A selection, not a sort, unless the full
+    // sort already exists; a later call with a larger k selects again.
+    std::shared_ptr<const std::vector<double>> lowest(size_t k) const;
+    
+    const HigherMoments& moments() const;
+    
+    // Silverman's rule of thumb 1.06 * sigma * n^(-1/5)
+    double silvermanBandwidth() const;
+    
+    // Sheather-Jones and least-squares cross-validation bandwidths on
+    // BandwidthSelector's default grid
+    double sheatherJonesBandwidth() const;
+    double lscvBandwidth() const;
+
+private:
+    std::vector<double> owned_;
+    const std::vector<double>* values_;
+    
+    // Tail and full sort; the tail is replaced when a deeper one is needed
+    mutable std::mutex orderMutex_;
+    mutable std::shared_ptr<const std::vector<double>> sorted_;
+    mutable std::shared_ptr<const std::vector<double>> tail_;
+    mutable size_t tailSize_ = 0;
+    
+    mutable std::once_flag momentsOnce_;
+    mutable HigherMoments moments_;
+    
+    mutable std::once_flag sheatherJonesOnce_;
+    mutable double sheatherJones_ = 0.0;
+    mutable std::once_flag lscvOnce_;
+    mutable double lscv_ = 0.0;
+};
+
+#endif // RETURN_SERIES_H
@@ -0,0 +1,40 @@
+#ifndef ROLLING_HISTORICAL_VAR_H
+#define ROLLING_HISTORICAL_VAR_H
+
+#include "var_calculator.h"
+#include "order_statistic_tree.h"
+#include <vector>
+#include <cstddef>
+
+// Historical VaR/ES over a sliding window, updated in O(log w) per
+// observation with an order-statistic tree. Uses the same interpolated
+// quantile as HistoricalVaR and the same ceil(alpha * w) ES tail.
+class RollingHistoricalVaR {
+public:
+    RollingHistoricalVaR(size_t window, double confidence);
+    
+    // Adds an observation, dropping the oldest one once the window is full.
+    // NaN and infinite returns are rejected and leave the window unchanged.
+    void push(double value);
+    
+    void reset();
+    
+    // Estimates over the observations currently held (at least one)
+    double var() const;
+    double es() const;
+    
+    size_t size() const { return tree_.size(); }
+    bool full() const { return tree_.size() == window_; }
+    size_t window() const { return window_; }
+    
+    static RollingRiskSeries compute(const std::vector<double>& returns, size_t window, double confidence);
+
+private:
+    size_t window_;
+    double confidence_;
+    std::vector<double> ring_;   // Window contents in arrival order
+    size_t oldest_ = 0;
+    OrderStatisticTree tree_;
+};
+
+#endif // ROLLING_HISTORICAL_VAR_H
@@ -0,0 +1,211 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include "cpu_features.h"
+
+// Vectorized elementary functions for the AVX2 and AVX-512 code paths.
+// Only the argument ranges needed by the random variate generators and the
+// normal distribution functions are supported: log of positive normal
+// numbers, sin/cos of 2*pi*u for u in [0, 1), and exp of arguments up to
+// 709, with results below the normal range flushed to zero. Accuracy is
+// within a few ulp of the libm results.
+#if VAR_X86_SIMD
+
+#include <immintrin.h>
+
+#define VAR_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define VAR_TARGET_AVX512 __attribute__((target("avx512f")))
+
+namespace simd {
+
+const double LN2_HI = 6.93147180369123816490e-01;
+const double LN2_LO = 1.90821492927058770002e-10;
+const double SQRT2 = 1.41421356237309504880;
+const double TWO_PI = 6.28318530717958647692;
+const double LOG2E = 1.44269504088896338700;
+const double EXP_MIN = -708.0;   // exp(EXP_MIN) is still a normal number
+const double EXP_MAX = 709.0;
+
+// log(m) = 2*atanh(f) with f = (m-1)/(m+1): coefficients 2/(2k+1) in f^2
+const double LOG_C[] = {2.0, 2.0 / 3.0, 2.0 / 5.0, 2.0 / 7.0, 2.0 / 9.0, 2.0 / 11.0,
+                        2.0 / 13.0, 2.0 / 15.0, 2.0 / 17.0, 2.0 / 19.0, 2.0 / 21.0};
+
+// Taylor coefficients of exp(r) for |r| <= ln(2)/2
+const double EXP_C[] = {1.0, 1.0, 1.0 / 2.0, 1.0 / 6.0, 1.0 / 24.0, 1.0 / 120.0, 1.0 / 720.0,
+                        1.0 / 5040.0, 1.0 / 40320.0, 1.0 / 362880.0, 1.0 / 3628800.0,
+                        1.0 / 39916800.0, 1.0 / 479001600.0, 1.0 / 6227020800.0};
+
+// Taylor coefficients of sin(r)/r and cos(r) in r^2 for |r| <= pi/4
+const double SIN_C[] = {1.0, -1.0 / 6.0, 1.0 / 120.0, -1.0 / 5040.0, 1.0 / 362880.0,
+                        -1.0 / 39916800.0, 1.0 / 6227020800.0, -1.0 / 1307674368000.0,
+                        1.0 / 355687428096000.0};
+const double COS_C[] = {1.0, -1.0 / 2.0, 1.0 / 24.0, -1.0 / 720.0, 1.0 / 40320.0,
+                        -1.0 / 3628800.0, 1.0 / 479001600.0, -1.0 / 87178291200.0,
+                        1.0 / 20922789888000.0};
+
+// ---------------------------------------------------------------- AVX2 ---
+
+VAR_TARGET_AVX2 inline __m256d horner256(__m256d x, const double* c, int n) {
+    __m256d acc = _mm256_set1_pd(c[n - 1]);
+    for (int i = n - 2; i >= 0; --i) {
+        acc = _mm256_fmadd_pd(acc, x, _mm256_set1_pd(c[i]));
+    }
+    return acc;
+}
+
+VAR_TARGET_AVX2 inline __m256d log256(__m256d x) {
+    const __m256i mantissaMask = _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    const __m256i oneBits = _mm256_set1_epi64x(0x3FF0000000000000LL);
+    const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+    const __m256d one = _mm256_set1_pd(1.0);
+    
+    // x = m * 2^e with m in [1, 2)
+    __m256i bits = _mm256_castpd_si256(x);
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, mantissaMask), oneBits));
+    __m256i biased = _mm256_srli_epi64(bits, 52);
+    __m256d e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(biased, magic)),
+                              _mm256_set1_pd(4503599627370496.0 + 1023.0));
+    
+    // Recentre m into [sqrt(1/2), sqrt(2))
+    __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(SQRT2), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+    e = _mm256_add_pd(e, _mm256_and_pd(big, one));
+    
+    __m256d f = _mm256_div_pd(_mm256_sub_pd(m, one), _mm256_add_pd(m, one));
+    __m256d poly = horner256(_mm256_mul_pd(f, f), LOG_C, 11);
+    
+    __m256d result = _mm256_fmadd_pd(e, _mm256_set1_pd(LN2_LO), _mm256_mul_pd(f, poly));
+    return _mm256_fmadd_pd(e, _mm256_set1_pd(LN2_HI), result);
+}
+
+// exp(hi + lo) without rounding the sum first: lo carries the low-order
+// part of an argument such as -x*x/2, whose rounding error would otherwise
+// be amplified by the size of x*x
+VAR_TARGET_AVX2 inline __m256d expSum256(__m256d hi, __m256d lo) {
+    __m256d x = _mm256_add_pd(hi, lo);
+    __m256d k = _mm256_round_pd(_mm256_mul_pd(_mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(EXP_MIN)),
+                                                            _mm256_set1_pd(EXP_MAX)),
+                                              _mm256_set1_pd(LOG2E)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    
+    // x = k*ln2 + r with |r| <= ln(2)/2; the first step is exact
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_HI), hi);
+    r = _mm256_add_pd(r, _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_LO), lo));
+    __m256d poly = horner256(r, EXP_C, 14);
+    
+    // 2^k from the exponent bits
+    __m256i biased = _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(k)), _mm256_set1_epi64x(1023));
+    __m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(biased, 52));
+    
+    __m256d tooSmall = _mm256_cmp_pd(x, _mm256_set1_pd(EXP_MIN), _CMP_LT_OQ);
+    return _mm256_andnot_pd(tooSmall, _mm256_mul_pd(poly, scale));
+}
+
+VAR_TARGET_AVX2 inline __m256d exp256(__m256d x) {
+    return expSum256(x, _mm256_setzero_pd());
+}
+
+// sin and cos of 2*pi*u for u in [0, 1)
+VAR_TARGET_AVX2 inline void sinCos2Pi256(__m256d u, __m256d& sinOut, __m256d& cosOut) {
+    const __m256d signBit = _mm256_set1_pd(-0.0);
+    
+    // 2*pi*u = q*pi/2 + r with |r| <= pi/4
+    __m256d q = _mm256_round_pd(_mm256_mul_pd(u, _mm256_set1_pd(4.0)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_mul_pd(_mm256_fnmadd_pd(q, _mm256_set1_pd(0.25), u), _mm256_set1_pd(TWO_PI));
+    __m256d r2 = _mm256_mul_pd(r, r);
+    
+    __m256d s = _mm256_mul_pd(r, horner256(r2, SIN_C, 9));
+    __m256d c = horner256(r2, COS_C, 9);
+    
+    __m256d q1 = _mm256_cmp_pd(q, _mm256_set1_pd(1.0), _CMP_EQ_OQ);
+    __m256d q2 = _mm256_cmp_pd(q, _mm256_set1_pd(2.0), _CMP_EQ_OQ);
+    __m256d q3 = _mm256_cmp_pd(q, _mm256_set1_pd(3.0), _CMP_EQ_OQ);
+    
+    __m256d swap = _mm256_or_pd(q1, q3);
+    __m256d sinNeg = _mm256_or_pd(q2, q3);
+    __m256d cosNeg = _mm256_or_pd(q1, q2);
+    
+    sinOut = _mm256_xor_pd(_mm256_blendv_pd(s, c, swap), _mm256_and_pd(sinNeg, signBit));
+    cosOut = _mm256_xor_pd(_mm256_blendv_pd(c, s, swap), _mm256_and_pd(cosNeg, signBit));
+}
+
+// ------------------------------------------------------------- AVX-512 ---
+
+VAR_TARGET_AVX512 inline __m512d horner512(__m512d x, const double* c, int n) {
+    __m512d acc = _mm512_set1_pd(c[n - 1]);
+    for (int i = n - 2; i >= 0; --i) {
+        acc = _mm512_fmadd_pd(acc, x, _mm512_set1_pd(c[i]));
+    }
+    return acc;
+}
+
+VAR_TARGET_AVX512 inline __m512d log512(__m512d x) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    
+    // x = m * 2^e with m in [1, 2)
+    __m512d m = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+    __m512d e = _mm512_getexp_pd(x);
+    
+    // Recentre m into [sqrt(1/2), sqrt(2))
+    __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(SQRT2), _CMP_GT_OQ);
+    m = _mm512_mask_mul_pd(m, big, m, _mm512_set1_pd(0.5));
+    e = _mm512_mask_add_pd(e, big, e, one);
+    
+    __m512d f = _mm512_div_pd(_mm512_sub_pd(m, one), _mm512_add_pd(m, one));
+    __m512d poly = horner512(_mm512_mul_pd(f, f), LOG_C, 11);
+    
+    __m512d result = _mm512_fmadd_pd(e, _mm512_set1_pd(LN2_LO), _mm512_mul_pd(f, poly));
+    return _mm512_fmadd_pd(e, _mm512_set1_pd(LN2_HI), result);
+}
+
+// exp(hi + lo) without rounding the sum first, as expSum256
+VAR_TARGET_AVX512 inline __m512d expSum512(__m512d hi, __m512d lo) {
+    __m512d x = _mm512_add_pd(hi, lo);
+    __m512d k = _mm512_roundscale_pd(_mm512_mul_pd(_mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(EXP_MIN)),
+                                                                 _mm512_set1_pd(EXP_MAX)),
+                                                   _mm512_set1_pd(LOG2E)),
+                                     _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    
+    __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(LN2_HI), hi);
+    r = _mm512_add_pd(r, _mm512_fnmadd_pd(k, _mm512_set1_pd(LN2_LO), lo));
+    __m512d result = _mm512_scalef_pd(horner512(r, EXP_C, 14), k);
+    
+    __mmask8 tooSmall = _mm512_cmp_pd_mask(x, _mm512_set1_pd(EXP_MIN), _CMP_LT_OQ);
+    return _mm512_mask_mov_pd(result, tooSmall, _mm512_setzero_pd());
+}
+
+VAR_TARGET_AVX512 inline __m512d exp512(__m512d x) {
+    return expSum512(x, _mm512_setzero_pd());
+}
+
+// sin and cos of 2*pi*u for u in [0, 1)
+VAR_TARGET_AVX512 inline void sinCos2Pi512(__m512d u, __m512d& sinOut, __m512d& cosOut) {
+    __m512d q = _mm512_roundscale_pd(_mm512_mul_pd(u, _mm512_set1_pd(4.0)),
+                                     _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d r = _mm512_mul_pd(_mm512_fnmadd_pd(q, _mm512_set1_pd(0.25), u), _mm512_set1_pd(TWO_PI));
+    __m512d r2 = _mm512_mul_pd(r, r);
+    
+    __m512d s = _mm512_mul_pd(r, horner512(r2, SIN_C, 9));
+    __m512d c = horner512(r2, COS_C, 9);
+    
+    __mmask8 q1 = _mm512_cmp_pd_mask(q, _mm512_set1_pd(1.0), _CMP_EQ_OQ);
+    __mmask8 q2 = _mm512_cmp_pd_mask(q, _mm512_set1_pd(2.0), _CMP_EQ_OQ);
+    __mmask8 q3 = _mm512_cmp_pd_mask(q, _mm512_set1_pd(3.0), _CMP_EQ_OQ);
+    
+    __mmask8 swap = q1 | q3;
+    __mmask8 sinNeg = q2 | q3;
+    __mmask8 cosNeg = q1 | q2;
+    
+    __m512d sinVal = _mm512_mask_blend_pd(swap, s, c);
+    __m512d cosVal = _mm512_mask_blend_pd(swap, c, s);
+    
+    sinOut = _mm512_mask_sub_pd(sinVal, sinNeg, _mm512_setzero_pd(), sinVal);
+    cosOut = _mm512_mask_sub_pd(cosVal, cosNeg, _mm512_setzero_pd(), cosVal);
+}
+
+} // namespace simd
+
+#endif // VAR_X86_SIMD
+
+#endif // SIMD_MATH_H
@@ -0,0 +1,41 @@
+#ifndef SIMULATION_ENGINE_H
+#define SIMULATION_ENGINE_H
+
+#include "normal_generator.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Parallel generator of simulated return paths.
+//
+// Paths are produced in fixed-size blocks and block b always draws from
+// Philox stream b of the seed, so the output is bit-identical for a given
+// seed regardless of how many threads fill it.
+class SimulationEngine {
+public:
+    static constexpr size_t BLOCK_SIZE = 16384;
+    
+    SimulationEngine(uint64_t seed, unsigned numThreads = 0,
+                     NormalGenerator::Backend backend = NormalGenerator::detectBackend());
+    
+    std::vector<double> simulateNormal(double mean, double stdDev, size_t n) const;
+    
+    // Pairs (mean + stdDev*z, mean - stdDev*z) from one normal draw each
+    std::vector<double> simulateAntithetic(double mean, double stdDev, size_t n) const;
+    
+    // Owen-scrambled one-dimensional Sobol points mapped through the inverse
+    // normal CDF. The n points are split into `replicates` contiguous sets
+    // of batchSize points, each with its own independent scramble.
+    std::vector<double> simulateSobol(double mean, double stdDev, size_t n, size_t batchSize) const;
+    
+    uint64_t seed() const { return seed_; }
+    unsigned numThreads() const { return numThreads_; }
+    NormalGenerator::Backend backend() const { return generator_.backend(); }
+
+private:
+    uint64_t seed_;
+    unsigned numThreads_;
+    NormalGenerator generator_;
+};
+
+#endif // SIMULATION_ENGINE_H
@@ -0,0 +1,71 @@
+#ifndef STREAM_MONITOR_H
+#define STREAM_MONITOR_H
+
+#include "rolling_historical_var.h"
+#include "streaming_moments.h"
+#include <chrono>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Per-update latencies, in microseconds, and their percentiles
+class LatencyRecorder {
+public:
+    void record(double micros) { samples_.push_back(micros); }
+    void reset() { samples_.clear(); }
+
+    size_t count() const { return samples_.size(); }
+
+    // Nearest-rank percentile, p in [0, 100]; 0 if nothing was recorded
+    double percentile(double p) const;
+    double max() const;
+
+private:
+    std::vector<double> samples_;
+};
+
+// Live VaR/ES over a feed of returns. Keeps incremental state for the
+// rolling historical, rolling parametric and EWMA estimators, so each
+// observation costs O(log window), and writes one CSV line of estimates
+// per batch of observations.
+//
+// Input is one return per line; for CSV lines the last field is used, and
+// lines without a finite number (headers, blanks, nan, inf) are skipped.
+class StreamMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StreamMonitor(size_t window, double confidence, double lambda = EwmaVariance::RISKMETRICS_LAMBDA,
+                  size_t batchSize = 1);
+
+    void push(double value);
+
+    // Reads until end of input, writing the column header and then an
+    // update per batch. Each update is flushed so downstream readers see
+    // it immediately; its latency runs from the arrival of the oldest
+    // observation in the batch to the flush.
+    void run(std::istream& in, std::ostream& out);
+
+    void writeHeader(std::ostream& out) const;
+    void writeUpdate(std::ostream& out) const;
+
+    // Latency summary: count and p50/p90/p99/p99.9/max
+    void writeLatencyReport(std::ostream& out) const;
+
+    size_t count() const { return count_; }
+    const LatencyRecorder& latency() const { return latency_; }
+
+    // Return on a line of input, if it has one
+    static bool parseLine(const std::string& line, double& value);
+
+private:
+    size_t batchSize_;
+    size_t count_ = 0;
+    RollingHistoricalVaR historical_;
+    StreamingParametricVaR parametric_;
+    StreamingParametricVaR ewma_;
+    LatencyRecorder latency_;
+};
+
+#endif // STREAM_MONITOR_H
@@ -0,0 +1,97 @@
+#ifndef STREAMING_MOMENTS_H
+#define STREAMING_MOMENTS_H
+
+#include "var_calculator.h"
+#include <vector>
+#include <cstddef>
+
+// Welford mean/variance accumulator. Observations can be added one at a
+// time, removed again (for sliding windows) and partial accumulators from
+// different chunks can be merged (Chan et al.).
+class RunningMoments {
+public:
+    void add(double x);
+    void remove(double x);
+    void merge(const RunningMoments& other);
+    void reset();
+    
+    size_t count() const { return count_; }
+    double mean() const { return mean_; }
+    
+    // Sample variance (n - 1 denominator), 0 below two observations
+    double variance() const;
+    double stdDev() const;
+    
+    static RunningMoments of(const std::vector<double>& data);
+
+private:
+    size_t count_ = 0;
+    double mean_ = 0.0;
+    double m2_ = 0.0;
+};
+
+// RiskMetrics exponentially weighted variance: s2 = lambda*s2 + (1-lambda)*r^2,
+// with zero mean and the first observation's square as the starting value.
+class EwmaVariance {
+public:
+    static constexpr double RISKMETRICS_LAMBDA = 0.94;
+    
+    explicit EwmaVariance(double lambda = RISKMETRICS_LAMBDA);
+    
+    void add(double r);
+    void reset();
+    
+    size_t count() const { return count_; }
+    double variance() const { return variance_; }
+    double volatility() const;
+    double lambda() const { return lambda_; }
+
+private:
+    double lambda_;
+    double variance_ = 0.0;
+    size_t count_ = 0;
+};
+
+// Normal VaR/ES updated in O(1) per observation, from either a sliding
+// window of Welford moments or a RiskMetrics EWMA volatility.
+class StreamingParametricVaR {
+public:
+    enum class Estimator { Window, Ewma };
+    
+    static StreamingParametricVaR window(size_t window, double confidence);
+    static StreamingParametricVaR ewma(double lambda, double confidence);
+    
+    void push(double value);
+    void reset();
+    
+    double var() const;
+    double es() const;
+    
+    size_t count() const;
+    Estimator estimator() const { return estimator_; }
+    
+    // VaR/ES after each observation once `window` observations (or, for
+    // EWMA, the warm-up count) have been seen; same layout as the
+    // rolling historical series
+    static RollingRiskSeries compute(const std::vector<double>& returns, size_t window, double confidence);
+    static RollingRiskSeries computeEwma(const std::vector<double>& returns, double lambda,
+                                         size_t warmup, double confidence);
+
+private:
+    StreamingParametricVaR(Estimator estimator, size_t window, double lambda, double confidence);
+    
+    Estimator estimator_;
+    size_t window_;
+    double z_;
+    double alpha_;
+    
+    RunningMoments moments_;
+    EwmaVariance ewma_;
+    std::vector<double> ring_;
+    size_t oldest_ = 0;
+    
+    double mean() const;
+    double sigma() const;
+};
+
+#endif // STREAMING_MOMENTS_H
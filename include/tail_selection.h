@@ -0,0 +1,25 @@
+#ifndef TAIL_SELECTION_H
+#define TAIL_SELECTION_H
+
+#include <vector>
+#include <cstddef>
+
+// Lower-tail selection shared by the sample-based calculators.
+//
+// VaR and ES only read the smallest alpha*n order statistics, so instead of
+// sorting the whole sample we partition it with nth_element and sort just
+// the tail: O(n + k log k) instead of O(n log n).
+class TailSelection {
+public:
+    // Number of observations averaged into ES: ceil(alpha * n), at least 1
+    static size_t esTailCount(size_t n, double alpha);
+    
+    // Rearranges data so that its first k elements are the k smallest, in
+    // ascending order. The remaining elements are left in unspecified order.
+    static void selectLowest(std::vector<double>& data, size_t k);
+    
+    // Copy of data with its k smallest elements selected to the front
+    static std::vector<double> lowestCopy(const std::vector<double>& data, size_t k);
+};
+
+#endif // TAIL_SELECTION_H
@@ -1,25 +1,115 @@
 #ifndef VAR_CALCULATOR_H
 #define VAR_CALCULATOR_H
 
+#include "return_series.h"
+#include <memory>
 #include <vector>
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
-// Base class for all VaR calculators
+// VaR, ES and statistics of the loss tail they were computed from
+struct RiskMeasures {
+    double var = 0.0;
+    double es = 0.0;
+    size_t tailCount = 0;       // Observations averaged into ES (0 for closed-form methods)
+    double worstLoss = 0.0;     // Largest loss in the tail
+    double tailStdDev = 0.0;    // Dispersion of the tail returns
+    double varStandardError = 0.0;  // Sampling error of simulated estimates (0 if not estimated)
+    double esStandardError = 0.0;
+};
+
+// VaR and ES for every full window of a return series. Entry i covers
+// returns [i, i + window), i.e. it is the estimate available on the date
+// of return i + window - 1.
+struct RollingRiskSeries {
+    size_t window = 0;
+    std::vector<double> var;
+    std::vector<double> es;
+};
+
+// How bootstrap resamples are drawn from the return series
+enum class BootstrapScheme {
+    Iid,            // Observations drawn independently (Efron)
+    MovingBlock,    // Fixed-length blocks of consecutive returns (Kunsch)
+    Stationary      // Blocks of geometric length, wrapping around (Politis-Romano)
+};
+
+// "iid", "block" or "stationary"; false for anything else
+bool parseBootstrapScheme(const std::string& name, BootstrapScheme& scheme);
+
+struct BootstrapOptions {
+    BootstrapScheme scheme = BootstrapScheme::Iid;
+    size_t resamples = 1000;
+    size_t blockLength = 0;     // Mean block length; 0 picks n^(1/3)
+    double level = 0.90;        // Coverage of the interval
+    uint64_t seed = 42;
+    unsigned numThreads = 0;    // 0 uses every hardware thread
+};
+
+// Percentile bootstrap interval around a point estimate
+struct BootstrapInterval {
+    RiskMeasures estimate;      // On the original series
+    double level = 0.0;
+    size_t resamples = 0;
+    size_t blockLength = 0;     // 1 for the iid scheme
+    double varLower = 0.0;
+    double varUpper = 0.0;
+    double esLower = 0.0;
+    double esUpper = 0.0;
+    double varStandardError = 0.0;  // Dispersion of the resampled estimates
+    double esStandardError = 0.0;
+};
+
+// Base class for all VaR calculators. Returns arrive as a ReturnSeries, so
+// the sort, moments and bandwidth of one series are computed once however
+// many calculators and calls read them; a plain vector converts implicitly.
 class VarCalculator {
 public:
     virtual ~VarCalculator() = default;
     
-    virtual double calculateVaR(const std::vector<double>& returns, double confidence) = 0;
-    virtual double calculateES(const std::vector<double>& returns, double confidence) = 0;
+    virtual double calculateVaR(const ReturnSeries& returns, double confidence) = 0;
+    virtual double calculateES(const ReturnSeries& returns, double confidence) = 0;
+    
+    // VaR and ES from one pass over the method's sample. The default runs
+    // both calculations; methods that sort or simulate override it to do
+    // that work once and read every measure off the same tail.
+    virtual RiskMeasures calculateRisk(const ReturnSeries& returns, double confidence);
+    
+    // Risk measures for several confidence levels, in the order given. The
+    // default calls calculateRisk per level; overrides do their expensive
+    // step (sort, simulation, KDE table) once for the whole batch.
+    virtual std::vector<RiskMeasures> calculateRiskBatch(const ReturnSeries& returns,
+                                                         const std::vector<double>& confidences);
     
     virtual std::string getMethodName() const = 0;
     
+    // Independent copy with the same settings, e.g. one per backtest worker
+    virtual std::unique_ptr<VarCalculator> clone() const = 0;
+    
+    // Confidence interval of VaR and ES from recomputing them on resampled
+    // series. Resample i always uses Philox stream i of options.seed, so the
+    // interval does not depend on the thread count. Calculators that run
+    // their own worker threads (Monte Carlo) should be given one thread.
+    BootstrapInterval bootstrapInterval(const ReturnSeries& returns, double confidence,
+                                        const BootstrapOptions& options = BootstrapOptions()) const;
+    
 protected:
+    // Risk measures of a scratch sample owned by the caller, which may be
+    // reordered. Used by the bootstrap; sample-based methods override it to
+    // select the tail in place instead of copying the sample.
+    virtual RiskMeasures calculateRiskInPlace(std::vector<double>& sample, double confidence);
+    
+
     // Utility functions
     static double mean(const std::vector<double>& data);
     static double standardDeviation(const std::vector<double>& data);
     static std::vector<double> sortedCopy(const std::vector<double>& data);
-    static double expectedShortfall(const std::vector<double>& data, double confidence);
+    static double expectedShortfall(const ReturnSeries& returns, double confidence);
+    
+    // ES and tail statistics of a sample whose lowest ceil(alpha * n)
+    // elements are sorted at the front (VaR is left at 0)
+    static RiskMeasures summarizeTail(const std::vector<double>& sorted, double confidence);
 };
 
 #endif // VAR_CALCULATOR_H
@@ -0,0 +1,25 @@
+// Global operator new that reports to Profiler::recordAllocation while
+// allocation tracking is on. Only executables that print allocation counts
+// link this file; everything else keeps the standard allocator.
+
+#include "profiler.h"
+#include <cstdlib>
+#include <new>
+
+void* operator new(size_t size) {
+    if (Profiler::trackingAllocations()) {
+        Profiler::recordAllocation(size);
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
@@ -1,4 +1,12 @@
 #include "backtesting.h"
+#include "profiler.h"
+#include "var_calculator.h"
+#include "parallel.h"
+#include "special_functions.h"
+#include "cpu_features.h"
+#include "simd_math.h"
+#include <memory>
+#include <stdexcept>
 #include <cmath>
 #include <algorithm>
 #include <sstream>
@@ -8,21 +16,16 @@ BacktestingResult Backtesting::performBacktest(const std::vector<double>& return
                                                double var,
                                                double es,
                                                double confidence) {
+    VAR_PROFILE_SCOPE("backtest.insample");
     BacktestingResult result;
     result.var = var;
     result.es = es;
     result.totalObservations = static_cast<int>(returns.size());
-    result.exceeds = 0;
-    result.exceedsES = 0;
     
-    for (double ret : returns) {
-        if (exceedsVaR(ret, var)) {
-            result.exceeds++;
-        }
-        if (exceedsES(ret, es)) {
-            result.exceedsES++;
-        }
-    }
+    // VaR and ES thresholds counted in the same pass
+    ExceedanceMatrix matrix = countExceedances(returns, {{var, es}});
+    result.exceeds = static_cast<int>(matrix.count(0, 0));
+    result.exceedsES = static_cast<int>(matrix.count(0, 1));
     
     double expectedRate = 1.0 - confidence;
     result.exceedanceRate = static_cast<double>(result.exceeds) / result.totalObservations;
@@ -32,17 +35,19 @@ BacktestingResult Backtesting::performBacktest(const std::vector<double>& return
     result.isAccurate = std::abs(result.exceedanceRate - expectedRate) <= tolerance;
     
     //result.accuracy = calculateAccuracyScore(result.exceedanceRate, expectedRate);
-    result.accuracy = 100.0 - (std::abs(result.exceedanceRate - expectedRate) / expectedRate * 100.0);
+    result.accuracy = std::max(0.0, 100.0 - (std::abs(result.exceedanceRate - expectedRate) / expectedRate * 100.0));
     
     return result;
 }
 
+// VaR and ES are positive losses, so only returns below -VaR are breaches;
+// gains never are
 bool Backtesting::exceedsVaR(double returnValue, double var) {
-    return std::abs(returnValue) > var;
+    return returnValue < -var;
 }
 
 bool Backtesting::exceedsES(double returnValue, double es) {
-    return std::abs(returnValue) > es;
+    return returnValue < -es;
 }
 
 double Backtesting::calculateAccuracyScore(double empiricalRate, double expectedRate) {
@@ -53,6 +58,284 @@ double Backtesting::calculateAccuracyScore(double empiricalRate, double expected
     return std::max(0.0, std::min(100.0, accuracy));
 }
 
+namespace {
+
+// n * log(p), taken as 0 when n is 0 so that empty cells drop out
+double weightedLog(double n, double p) {
+    return n > 0.0 ? n * std::log(p) : 0.0;
+}
+
+size_t popcount(uint64_t bits) {
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_popcountll(bits));
+#else
+    size_t count = 0;
+    for (; bits; bits &= bits - 1) ++count;
+    return count;
+#endif
+}
+
+// Exceedance kernels: for every 64-return block and every limit (-VaR),
+// set bit j of the block's word when block[j] < limit. Bitmaps are laid
+// out limit-major, words per limit.
+void exceedanceBitsScalar(const double* returns, size_t n, const double* limits, size_t numLimits,
+                          uint64_t* bitmaps, size_t words) {
+    for (size_t w = 0; w < words; ++w) {
+        const double* block = returns + 64 * w;
+        size_t length = std::min<size_t>(64, n - 64 * w);
+        for (size_t k = 0; k < numLimits; ++k) {
+            uint64_t bits = 0;
+            for (size_t j = 0; j < length; ++j) {
+                bits |= static_cast<uint64_t>(block[j] < limits[k]) << j;
+            }
+            bitmaps[k * words + w] = bits;
+        }
+    }
+}
+
+#if VAR_X86_SIMD
+
+VAR_TARGET_AVX2 void exceedanceBitsAvx2(const double* returns, size_t n, const double* limits, size_t numLimits,
+                                        uint64_t* bitmaps, size_t words) {
+    for (size_t w = 0; w < words; ++w) {
+        const double* block = returns + 64 * w;
+        size_t length = std::min<size_t>(64, n - 64 * w);
+        size_t vectorLength = length & ~size_t(3);
+        for (size_t k = 0; k < numLimits; ++k) {
+            __m256d limit = _mm256_set1_pd(limits[k]);
+            uint64_t bits = 0;
+            for (size_t j = 0; j < vectorLength; j += 4) {
+                __m256d lt = _mm256_cmp_pd(_mm256_loadu_pd(block + j), limit, _CMP_LT_OQ);
+                bits |= static_cast<uint64_t>(_mm256_movemask_pd(lt)) << j;
+            }
+            for (size_t j = vectorLength; j < length; ++j) {
+                bits |= static_cast<uint64_t>(block[j] < limits[k]) << j;
+            }
+            bitmaps[k * words + w] = bits;
+        }
+    }
+}
+
+VAR_TARGET_AVX512 void exceedanceBitsAvx512(const double* returns, size_t n, const double* limits, size_t numLimits,
+                                            uint64_t* bitmaps, size_t words) {
+    for (size_t w = 0; w < words; ++w) {
+        const double* block = returns + 64 * w;
+        size_t length = std::min<size_t>(64, n - 64 * w);
+        size_t vectorLength = length & ~size_t(7);
+        for (size_t k = 0; k < numLimits; ++k) {
+            __m512d limit = _mm512_set1_pd(limits[k]);
+            uint64_t bits = 0;
+            for (size_t j = 0; j < vectorLength; j += 8) {
+                __mmask8 lt = _mm512_cmp_pd_mask(_mm512_loadu_pd(block + j), limit, _CMP_LT_OQ);
+                bits |= static_cast<uint64_t>(lt) << j;
+            }
+            for (size_t j = vectorLength; j < length; ++j) {
+                bits |= static_cast<uint64_t>(block[j] < limits[k]) << j;
+            }
+            bitmaps[k * words + w] = bits;
+        }
+    }
+}
+
+#endif // VAR_X86_SIMD
+
+} // namespace
+
+double ExceedanceMatrix::rate(size_t method, size_t level) const {
+    return observations > 0 ? static_cast<double>(count(method, level)) / observations : 0.0;
+}
+
+bool ExceedanceMatrix::exceeded(size_t method, size_t level, size_t i) const {
+    return (bitmaps[(method * levels + level) * words + i / 64] >> (i % 64)) & 1u;
+}
+
+std::vector<uint8_t> ExceedanceMatrix::hits(size_t method, size_t level) const {
+    std::vector<uint8_t> flags(observations);
+    for (size_t i = 0; i < observations; ++i) {
+        flags[i] = exceeded(method, level, i) ? 1 : 0;
+    }
+    return flags;
+}
+
+ExceedanceMatrix Backtesting::countExceedances(const std::vector<double>& returns,
+                                               const std::vector<std::vector<double>>& thresholds) {
+    VAR_PROFILE_SCOPE("backtest.exceedances");
+    ExceedanceMatrix matrix;
+    matrix.methods = thresholds.size();
+    matrix.levels = thresholds.empty() ? 0 : thresholds.front().size();
+    matrix.observations = returns.size();
+    matrix.words = (returns.size() + 63) / 64;
+    
+    // Breach of VaR v means return < -v
+    std::vector<double> limits;
+    limits.reserve(matrix.methods * matrix.levels);
+    for (const auto& row : thresholds) {
+        if (row.size() != matrix.levels) {
+            throw std::runtime_error("Every method needs a threshold for each confidence level");
+        }
+        for (double var : row) {
+            limits.push_back(-var);
+        }
+    }
+    
+    matrix.bitmaps.assign(limits.size() * matrix.words, 0);
+    
+#if VAR_X86_SIMD
+    if (CpuFeatures::hasAvx512()) {
+        exceedanceBitsAvx512(returns.data(), returns.size(), limits.data(), limits.size(),
+                             matrix.bitmaps.data(), matrix.words);
+    } else if (CpuFeatures::hasAvx2()) {
+        exceedanceBitsAvx2(returns.data(), returns.size(), limits.data(), limits.size(),
+                           matrix.bitmaps.data(), matrix.words);
+    } else
+#endif
+    {
+        exceedanceBitsScalar(returns.data(), returns.size(), limits.data(), limits.size(),
+                             matrix.bitmaps.data(), matrix.words);
+    }
+    
+    VAR_PROFILE_COUNT("backtest.comparisons", limits.size() * returns.size());
+    
+    matrix.counts.assign(limits.size(), 0);
+    for (size_t k = 0; k < limits.size(); ++k) {
+        for (size_t w = 0; w < matrix.words; ++w) {
+            matrix.counts[k] += popcount(matrix.bitmaps[k * matrix.words + w]);
+        }
+    }
+    
+    return matrix;
+}
+
+WalkForwardResult Backtesting::walkForward(const VarCalculator& calculator,
+                                           const std::vector<double>& returns,
+                                           size_t window,
+                                           double confidence,
+                                           unsigned numThreads) {
+    VAR_PROFILE_SCOPE("backtest.walkforward");
+    if (window == 0) {
+        throw std::runtime_error("Backtest window must hold at least one observation");
+    }
+    if (returns.size() <= window) {
+        throw std::runtime_error("Backtest needs more returns than the estimation window");
+    }
+    
+    WalkForwardResult result;
+    result.window = window;
+    result.confidence = confidence;
+    
+    size_t dates = returns.size() - window;
+    result.var.resize(dates);
+    result.es.resize(dates);
+    result.realized.assign(returns.begin() + window, returns.end());
+    result.hits.resize(dates);
+    
+    // One calculator and one window buffer per worker
+    unsigned workers = static_cast<unsigned>(std::min<size_t>(Parallel::resolveThreads(numThreads), dates));
+    std::vector<std::unique_ptr<VarCalculator>> clones;
+    std::vector<std::vector<double>> buffers(workers);
+    for (unsigned w = 0; w < workers; ++w) {
+        clones.push_back(calculator.clone());
+    }
+    
+    Parallel::forEach(dates, workers, [&](size_t i, unsigned worker) {
+        std::vector<double>& sample = buffers[worker];
+        sample.assign(returns.begin() + i, returns.begin() + i + window);
+        
+        RiskMeasures risk = clones[worker]->calculateRisk(sample, confidence);
+        result.var[i] = risk.var;
+        result.es[i] = risk.es;
+        result.hits[i] = exceedsVaR(result.realized[i], risk.var) ? 1 : 0;
+    });
+    
+    VAR_PROFILE_COUNT("backtest.forecasts", dates);
+    
+    for (uint8_t hit : result.hits) {
+        result.exceedances += hit;
+    }
+    result.exceedanceRate = static_cast<double>(result.exceedances) / dates;
+    
+    result.kupiec = kupiecTest(dates, result.exceedances, 1.0 - confidence);
+    result.independence = independenceTest(result.hits);
+    result.conditionalCoverage.statistic = result.kupiec.statistic + result.independence.statistic;
+    result.conditionalCoverage.degreesOfFreedom = 2;
+    result.conditionalCoverage.pValue = SpecialFunctions::chiSquaredSurvival(result.conditionalCoverage.statistic, 2);
+    
+    return result;
+}
+
+CoverageTest Backtesting::kupiecTest(size_t observations, size_t exceedances, double alpha) {
+    CoverageTest test;
+    if (observations == 0) {
+        return test;
+    }
+    
+    // LR = -2 log[ L(alpha) / L(x / N) ] for a binomial exceedance count
+    double n = static_cast<double>(observations);
+    double x = static_cast<double>(exceedances);
+    double observed = x / n;
+    
+    double logNull = weightedLog(n - x, 1.0 - alpha) + weightedLog(x, alpha);
+    double logAlternative = weightedLog(n - x, 1.0 - observed) + weightedLog(x, observed);
+    
+    test.statistic = std::max(0.0, -2.0 * (logNull - logAlternative));
+    test.pValue = SpecialFunctions::chiSquaredSurvival(test.statistic, 1);
+    return test;
+}
+
+CoverageTest Backtesting::independenceTest(const std::vector<uint8_t>& hits) {
+    CoverageTest test;
+    if (hits.size() < 2) {
+        return test;
+    }
+    
+    // Transition counts n[i][j]: exceedance state i followed by state j
+    double n[2][2] = {{0.0, 0.0}, {0.0, 0.0}};
+    for (size_t t = 1; t < hits.size(); ++t) {
+        n[hits[t - 1]][hits[t]] += 1.0;
+    }
+    
+    double pi0 = n[0][1] / std::max(1.0, n[0][0] + n[0][1]);
+    double pi1 = n[1][1] / std::max(1.0, n[1][0] + n[1][1]);
+    double pi = (n[0][1] + n[1][1]) / (n[0][0] + n[0][1] + n[1][0] + n[1][1]);
+    
+    double logNull = weightedLog(n[0][0] + n[1][0], 1.0 - pi) + weightedLog(n[0][1] + n[1][1], pi);
+    double logAlternative = weightedLog(n[0][0], 1.0 - pi0) + weightedLog(n[0][1], pi0)
+                          + weightedLog(n[1][0], 1.0 - pi1) + weightedLog(n[1][1], pi1);
+    
+    test.statistic = std::max(0.0, -2.0 * (logNull - logAlternative));
+    test.pValue = SpecialFunctions::chiSquaredSurvival(test.statistic, 1);
+    return test;
+}
+
+std::string Backtesting::formatWalkForwardResults(const WalkForwardResult& result) {
+    std::ostringstream oss;
+    
+    auto formatTest = [&](const std::string& name, const CoverageTest& test) {
+        oss << std::left << std::setw(28) << name
+            << "LR = " << std::fixed << std::setprecision(3) << std::setw(9) << test.statistic
+            << "p = " << std::setprecision(4) << test.pValue
+            << (test.rejected() ? "  (rejected at 5%)" : "") << "\n";
+    };
+    
+    oss << "\n" << std::string(80, '-') << "\n";
+    oss << "WALK-FORWARD BACKTEST (window " << result.window << ", "
+        << std::fixed << std::setprecision(1) << result.confidence * 100.0 << "%)\n";
+    oss << std::string(80, '-') << "\n";
+    
+    oss << "Forecasts: " << result.var.size() << "\n";
+    oss << "Exceedances: " << result.exceedances << " ("
+        << std::fixed << std::setprecision(2) << result.exceedanceRate * 100.0 << "%, expected "
+        << (1.0 - result.confidence) * 100.0 << "%)\n";
+    oss << "\n";
+    
+    formatTest("Kupiec POF", result.kupiec);
+    formatTest("Christoffersen independence", result.independence);
+    formatTest("Conditional coverage", result.conditionalCoverage);
+    oss << std::string(80, '-') << "\n";
+    
+    return oss.str();
+}
+
 std::string Backtesting::formatBacktestResults(const BacktestingResult& result) {
     std::ostringstream oss;
     
@@ -0,0 +1,74 @@
+#include "cornish_fisher_var.h"
+#include "profiler.h"
+#include "special_functions.h"
+#include <cmath>
+#include <stdexcept>
+
+double CornishFisherVaR::calculateVaR(const ReturnSeries& returns, double confidence) {
+    return calculateRisk(returns, confidence).var;
+}
+
+double CornishFisherVaR::calculateES(const ReturnSeries& returns, double confidence) {
+    return calculateRisk(returns, confidence).es;
+}
+
+RiskMeasures CornishFisherVaR::calculateRisk(const ReturnSeries& returns, double confidence) {
+    return calculateRiskBatch(returns, {confidence}).front();
+}
+
+std::vector<RiskMeasures> CornishFisherVaR::calculateRiskBatch(const ReturnSeries& returns,
+                                                              const std::vector<double>& confidences) {
+    VAR_PROFILE_SCOPE("cornishfisher.risk");
+    if (returns.empty()) {
+        throw std::runtime_error("Cannot calculate VaR with empty returns");
+    }
+    
+    // Every level is closed-form in the same four moments
+    const HigherMoments& moments = returns.moments();
+    
+    std::vector<RiskMeasures> risks;
+    risks.reserve(confidences.size());
+    for (double confidence : confidences) {
+        risks.push_back(fromMoments(moments, confidence));
+    }
+    return risks;
+}
+
+double CornishFisherVaR::adjustedQuantile(double z, double skewness, double excessKurtosis) {
+    double z2 = z * z;
+    double z3 = z2 * z;
+    return z + (z2 - 1.0) * skewness / 6.0
+             + (z3 - 3.0 * z) * excessKurtosis / 24.0
+             - (2.0 * z3 - 5.0 * z) * skewness * skewness / 36.0;
+}
+
+RiskMeasures CornishFisherVaR::fromMoments(const HigherMoments& moments, double confidence) {
+    double alpha = 1.0 - confidence;
+    if (alpha <= 0.0 || alpha >= 1.0) {
+        throw std::runtime_error("Confidence level must be between 0 and 1");
+    }
+    
+    double s = moments.skewness();
+    double k = moments.excessKurtosis();
+    double mu = moments.mean();
+    double sigma = moments.stdDev();
+    
+    // Lower-tail quantile c and the partial moments E[Z^j; Z < c] of a
+    // standard normal, j = 0..3
+    double c = SpecialFunctions::inverseNormalCdf(alpha);
+    double pdf = SpecialFunctions::normalPdf(c);
+    double i0 = alpha;
+    double i1 = -pdf;
+    double i2 = alpha - c * pdf;
+    double i3 = -(c * c + 2.0) * pdf;
+    
+    // Tail average of the expansion, term by term
+    double tailMean = i1 + (i2 - i0) * s / 6.0
+                    + (i3 - 3.0 * i1) * k / 24.0
+                    - (2.0 * i3 - 5.0 * i1) * s * s / 36.0;
+    
+    RiskMeasures risk;
+    risk.var = -(mu + sigma * adjustedQuantile(c, s, k));
+    risk.es = -(mu + sigma * tailMean / alpha);
+    return risk;
+}
@@ -1,94 +1,268 @@
 #include "csv_parser.h"
-#include <fstream>
-#include <sstream>
+#include "profiler.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <iostream>
-#include <cmath>
 #include <stdexcept>
 
-std::map<std::string, std::vector<double>> CSVParser::parseCSV(const std::string& filename, bool hasHeader) {
+namespace {
+
+// Columns parsed from one chunk of lines, plus the warnings they raised in
+// file order so they can be replayed after the threads join
+struct ChunkResult {
+    std::vector<std::vector<double>> columns;
+    std::vector<std::string> warnings;
+    size_t lines = 0;
+};
+
+// A projected field of the current line, held back until the line is known
+// to have the right number of fields
+struct PendingValue {
+    size_t slot;
+    double value;
+    std::string_view field;
+    bool parsed;
+};
+
+// Next line of text starting at pos, without its '\n'
+std::string_view nextLine(std::string_view text, size_t& pos) {
+    const char* begin = text.data() + pos;
+    const void* newline = std::memchr(begin, '\n', text.size() - pos);
+    size_t length = newline ? static_cast<const char*>(newline) - begin : text.size() - pos;
+    pos += newline ? length + 1 : length;
+    return std::string_view(begin, length);
+}
+
+// Start of the first line beginning at or after pos
+size_t nextLineStart(std::string_view text, size_t pos) {
+    while (pos < text.size() && pos > 0 && text[pos - 1] != '\n') {
+        ++pos;
+    }
+    return std::min(pos, text.size());
+}
+
+} // namespace
+
+size_t CSVTable::indexOf(const std::string& name) const {
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (names[i] == name) {
+            return i;
+        }
+    }
+    throw std::runtime_error("Column '" + name + "' not found in CSV file");
+}
+
+std::map<std::string, std::vector<double>> CSVParser::parseCSV(const std::string& filename, bool hasHeader,
+                                                                unsigned numThreads) {
+    VAR_PROFILE_SCOPE("csv.parse");
     std::map<std::string, std::vector<double>> data;
-    std::ifstream file(filename);
-    
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open file: " + filename);
+    MappedFile file(filename);
+    std::string_view text = file.view();
+    size_t pos = 0;
+    VAR_PROFILE_COUNT("csv.bytes", text.size());
+
+    if (!hasHeader) {
+        // If no header, use column indices as keys
+        auto columns = parseBody(text, {}, 0, false, numThreads);
+        for (size_t i = 0; i < columns.size(); ++i) {
+            data["col" + std::to_string(i)] = std::move(columns[i]);
+        }
+        return data;
+    }
+
+    // Read header line if present. Repeated names share one column, their
+    // values interleaved in file order.
+    std::vector<std::string_view> fields;
+    std::vector<std::string> names;
+    std::vector<size_t> slotOf;
+    if (pos < text.size()) {
+        splitLine(nextLine(text, pos), fields);
     }
-    
-    std::string line;
-    std::vector<std::string> headers;
-    
-    // Read header line if present
-    if (hasHeader && std::getline(file, line)) {
-        headers = splitLine(line);
-        for (const auto& header : headers) {
-            data[header] = std::vector<double>();
+    for (const auto& field : fields) {
+        auto it = std::find(names.begin(), names.end(), field);
+        slotOf.push_back(static_cast<size_t>(it - names.begin()));
+        if (it == names.end()) {
+            names.emplace_back(field);
         }
     }
-    
-    // Read data lines
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
-        
-        std::vector<std::string> values = splitLine(line);
-        
-        if (hasHeader) {
-            if (values.size() != headers.size()) {
-                std::cerr << "Warning: Line has different number of columns than header" << std::endl;
-                continue;
+
+    auto columns = parseBody(text.substr(pos), slotOf, names.size(), true, numThreads);
+    for (size_t i = 0; i < names.size(); ++i) {
+        data[names[i]] = std::move(columns[i]);
+    }
+
+    return data;
+}
+
+CSVTable CSVParser::parseColumns(const std::string& filename, const std::vector<std::string>& columns,
+                                 unsigned numThreads) {
+    VAR_PROFILE_SCOPE("csv.parse");
+    MappedFile file(filename);
+    std::string_view text = file.view();
+    size_t pos = 0;
+    VAR_PROFILE_COUNT("csv.bytes", text.size());
+
+    std::vector<std::string_view> headers;
+    if (pos < text.size()) {
+        splitLine(nextLine(text, pos), headers);
+    }
+
+    CSVTable table;
+    std::vector<size_t> slotOf(headers.size(), SKIPPED);
+
+    for (const auto& name : columns) {
+        if (std::find(table.names.begin(), table.names.end(), name) != table.names.end()) {
+            continue;
+        }
+
+        bool found = false;
+        for (size_t i = 0; i < headers.size(); ++i) {
+            if (headers[i] == name) {
+                slotOf[i] = table.names.size();
+                found = true;
             }
-            
-            for (size_t i = 0; i < values.size(); ++i) {
-                try {
-                    data[headers[i]].push_back(std::stod(values[i]));
-                } catch (const std::exception& e) {
-                    std::cerr << "Warning: Could not parse value '" << values[i] << "'" << std::endl;
+        }
+        if (!found) {
+            throw std::runtime_error("Column '" + name + "' not found in CSV file");
+        }
+        table.names.push_back(name);
+    }
+
+    table.columns = parseBody(text.substr(pos), slotOf, table.names.size(), true, numThreads);
+    return table;
+}
+
+std::vector<double> CSVParser::parseReturns(const std::string& filename, const std::string& columnName,
+                                            unsigned numThreads) {
+    CSVTable table = parseColumns(filename, {columnName}, numThreads);
+    return std::move(table.columns.front());
+}
+
+std::vector<std::vector<double>> CSVParser::parseBody(std::string_view body, const std::vector<size_t>& slotOf,
+                                                      size_t numSlots, bool hasHeader, unsigned numThreads) {
+    // Split the body at line boundaries, one chunk per worker
+    size_t numChunks = std::max<size_t>(1, std::min<size_t>(Parallel::resolveThreads(numThreads),
+                                                            body.size() / MIN_CHUNK_BYTES));
+    std::vector<size_t> bounds(numChunks + 1, body.size());
+    bounds[0] = 0;
+    for (size_t c = 1; c < numChunks; ++c) {
+        bounds[c] = nextLineStart(body, std::max(bounds[c - 1], body.size() / numChunks * c));
+    }
+
+    std::vector<ChunkResult> chunks(numChunks);
+
+    Parallel::forEach(numChunks, numThreads, [&](size_t c, unsigned) {
+        std::string_view chunk = body.substr(bounds[c], bounds[c + 1] - bounds[c]);
+        ChunkResult& result = chunks[c];
+        result.columns.resize(numSlots);
+        std::vector<PendingValue> pending;
+        size_t at = 0;
+
+        // Read data lines
+        while (at < chunk.size()) {
+            std::string_view line = nextLine(chunk, at);
+            if (line.empty()) continue;
+            result.lines++;
+
+            // Walk the delimiters, converting only projected fields
+            pending.clear();
+            size_t numFields = 0;
+            for (size_t start = 0; start < line.size(); ++numFields) {
+                const void* comma = std::memchr(line.data() + start, ',', line.size() - start);
+                size_t end = comma ? static_cast<const char*>(comma) - line.data() : line.size();
+
+                size_t slot = !hasHeader ? numFields
+                            : numFields < slotOf.size() ? slotOf[numFields] : SKIPPED;
+                if (slot != SKIPPED) {
+                    PendingValue value{slot, 0.0, trim(line.substr(start, end - start)), false};
+                    value.parsed = parseNumber(value.field, value.value);
+                    pending.push_back(value);
                 }
+
+                start = end + 1;
             }
-        } else {
-            // If no header, use column indices as keys
-            for (size_t i = 0; i < values.size(); ++i) {
-                std::string key = "col" + std::to_string(i);
-                if (data.find(key) == data.end()) {
-                    data[key] = std::vector<double>();
-                }
-                try {
-                    data[key].push_back(std::stod(values[i]));
-                } catch (const std::exception& e) {
-                    std::cerr << "Warning: Could not parse value '" << values[i] << "'" << std::endl;
+
+            if (hasHeader && numFields != slotOf.size()) {
+                result.warnings.push_back("Warning: Line has different number of columns than header");
+                continue;
+            }
+
+            // Without a header, column i appears on first sight
+            if (numFields > result.columns.size()) {
+                result.columns.resize(numFields);
+            }
+
+            for (const auto& value : pending) {
+                if (value.parsed) {
+                    result.columns[value.slot].push_back(value.value);
+                } else {
+                    result.warnings.push_back("Warning: Could not parse value '" + std::string(value.field) + "'");
                 }
             }
         }
+    });
+
+    // Stitch the chunks back together in file order, moving rather than
+    // copying when there is only one
+    std::vector<std::vector<double>> columns = std::move(chunks.front().columns);
+    for (const auto& warning : chunks.front().warnings) {
+        std::cerr << warning << std::endl;
     }
-    
-    file.close();
-    return data;
-}
+    VAR_PROFILE_COUNT("csv.lines", chunks.front().lines);
 
-std::vector<double> CSVParser::parseReturns(const std::string& filename, const std::string& columnName) {
-    auto data = parseCSV(filename, true);
-    
-    if (data.find(columnName) == data.end()) {
-        throw std::runtime_error("Column '" + columnName + "' not found in CSV file");
+    for (size_t c = 1; c < numChunks; ++c) {
+        for (const auto& warning : chunks[c].warnings) {
+            std::cerr << warning << std::endl;
+        }
+        VAR_PROFILE_COUNT("csv.lines", chunks[c].lines);
+        if (chunks[c].columns.size() > columns.size()) {
+            columns.resize(chunks[c].columns.size());
+        }
+        for (size_t i = 0; i < chunks[c].columns.size(); ++i) {
+            columns[i].insert(columns[i].end(), chunks[c].columns[i].begin(), chunks[c].columns[i].end());
+            std::vector<double>().swap(chunks[c].columns[i]);
+        }
     }
-    
-    return data[columnName];
+
+    return columns;
 }
 
-std::vector<std::string> CSVParser::splitLine(const std::string& line, char delimiter) {
-    std::vector<std::string> tokens;
-    std::stringstream ss(line);
-    std::string token;
-    
-    while (std::getline(ss, token, delimiter)) {
-        // Trim whitespace
-        size_t start = token.find_first_not_of(" \t\r\n");
-        size_t end = token.find_last_not_of(" \t\r\n");
-        
-        if (start != std::string::npos && end != std::string::npos) {
-            tokens.push_back(token.substr(start, end - start + 1));
-        } else if (start == std::string::npos) {
-            tokens.push_back("");
+void CSVParser::splitLine(std::string_view line, std::vector<std::string_view>& fields, char delimiter) {
+    fields.clear();
+    size_t start = 0;
+
+    while (start < line.size()) {
+        size_t end = line.find(delimiter, start);
+        if (end == std::string_view::npos) {
+            end = line.size();
         }
+
+        fields.push_back(trim(line.substr(start, end - start)));
+        start = end + 1;
     }
-    
-    return tokens;
+}
+
+std::string_view CSVParser::trim(std::string_view field) {
+    size_t first = field.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) {
+        return std::string_view();
+    }
+    size_t last = field.find_last_not_of(" \t\r\n");
+    return field.substr(first, last - first + 1);
+}
+
+bool CSVParser::parseNumber(std::string_view field, double& value) {
+    const char* first = field.data();
+    const char* last = field.data() + field.size();
+
+    // from_chars rejects the explicit plus sign that stod accepts
+    if (first != last && *first == '+' && last - first > 1 && first[1] != '-' && first[1] != '+') {
+        ++first;
+    }
+
+    auto [end, error] = std::from_chars(first, last, value);
+    return error == std::errc() && end != first;
 }
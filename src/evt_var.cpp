@@ -0,0 +1,185 @@
+#include "evt_var.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Threshold candidates scanned by the automatic choice
+const size_t MAX_CANDIDATES = 64;
+
+// Largest gap between the empirical CDF of the m exceedances over the fit's
+// threshold and the fitted GPD
+double kolmogorovSmirnov(const std::vector<double>& tail, const GpdFit& fit) {
+    size_t m = fit.exceedances;
+    double distance = 0.0;
+    for (size_t i = 1; i <= m; ++i) {
+        double model = EvtVaR::excessCdf(fit, -tail[m - i] - fit.threshold);
+        distance = std::max({distance, std::abs(model - static_cast<double>(i) / m),
+                             std::abs(model - static_cast<double>(i - 1) / m)});
+    }
+    return distance;
+}
+
+} // namespace
+
+double EvtVaR::calculateVaR(const ReturnSeries& returns, double confidence) {
+    return calculateRisk(returns, confidence).var;
+}
+
+double EvtVaR::calculateES(const ReturnSeries& returns, double confidence) {
+    return calculateRisk(returns, confidence).es;
+}
+
+RiskMeasures EvtVaR::calculateRisk(const ReturnSeries& returns, double confidence) {
+    return calculateRiskBatch(returns, {confidence}).front();
+}
+
+std::vector<RiskMeasures> EvtVaR::calculateRiskBatch(const ReturnSeries& returns,
+                                                    const std::vector<double>& confidences) {
+    VAR_PROFILE_SCOPE("evt.risk");
+    if (returns.empty()) {
+        throw std::runtime_error("Cannot calculate VaR with empty returns");
+    }
+    
+    // Every level must lie beyond the threshold, so the lowest one sets how
+    // many exceedances the fit needs at least
+    double maxAlpha = 0.0;
+    for (double confidence : confidences) {
+        maxAlpha = std::max(maxAlpha, 1.0 - confidence);
+    }
+    size_t minExceedances = std::max(MIN_EXCEEDANCES, static_cast<size_t>(maxAlpha * returns.size()));
+    GpdFit fit = fitTail(returns, minExceedances);
+    
+    // Tail statistics of the exceedances themselves, from the tail the fit
+    // already selected
+    auto selected = returns.lowest(fit.exceedances);
+    const std::vector<double>& tail = *selected;
+    double sum = 0.0;
+    for (size_t i = 0; i < fit.exceedances; ++i) {
+        sum += tail[i];
+    }
+    double tailMean = sum / fit.exceedances;
+    double variance = 0.0;
+    for (size_t i = 0; i < fit.exceedances; ++i) {
+        variance += (tail[i] - tailMean) * (tail[i] - tailMean);
+    }
+    
+    std::vector<RiskMeasures> results;
+    results.reserve(confidences.size());
+    for (double confidence : confidences) {
+        RiskMeasures risk;
+        risk.var = tailVaR(fit, confidence);
+        risk.es = tailES(fit, confidence);
+        risk.tailCount = fit.exceedances;
+        risk.worstLoss = -tail.front();
+        risk.tailStdDev = fit.exceedances > 1 ? std::sqrt(variance / (fit.exceedances - 1)) : 0.0;
+        results.push_back(risk);
+    }
+    
+    return results;
+}
+
+GpdFit EvtVaR::fitTail(const ReturnSeries& returns, size_t minExceedances) {
+    size_t n = returns.size();
+    size_t lowest = minExceedances + 1;
+    size_t highest = std::max(lowest, static_cast<size_t>(std::ceil(MAX_TAIL_FRACTION * n)));
+    if (highest >= n) {
+        throw std::runtime_error("EVT needs more than " + std::to_string(highest) + " returns at this confidence");
+    }
+    
+    // The deepest candidate plus the threshold point below it
+    auto selected = returns.lowest(highest + 1);
+    const std::vector<double>& tail = *selected;
+    
+    size_t stride = std::max<size_t>(1, (highest - lowest) / (MAX_CANDIDATES - 1));
+    std::vector<GpdFit> fits;
+    for (size_t m = lowest; m <= highest; m += stride) {
+        fits.push_back(fitExceedances(tail, m, n));
+    }
+    if (fits.back().exceedances != highest) {
+        fits.push_back(fitExceedances(tail, highest, n));
+    }
+    
+    size_t best = 0;
+    double bestDistance = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < fits.size(); ++i) {
+        double distance = kolmogorovSmirnov(tail, fits[i]);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = i;
+        }
+    }
+    
+    VAR_PROFILE_COUNT("evt.candidates", fits.size());
+    return fits[best];
+}
+
+GpdFit EvtVaR::fitExceedances(const std::vector<double>& tail, size_t m, size_t observations) {
+    if (m == 0 || tail.size() <= m) {
+        throw std::runtime_error("GPD fit needs the threshold point below the exceedances");
+    }
+    
+    GpdFit fit;
+    fit.threshold = -tail[m];
+    fit.exceedances = m;
+    fit.observations = observations;
+    
+    // Sample PWMs a0 = E[Y] and a1 = E[Y (1 - F(Y))], with the exceedances
+    // Y = loss - u in ascending order at plotting positions (i - 0.35) / m
+    double a0 = 0.0, a1 = 0.0;
+    for (size_t i = 1; i <= m; ++i) {
+        double y = -tail[m - i] - fit.threshold;
+        a0 += y;
+        a1 += y * (1.0 - (i - 0.35) / m);
+    }
+    a0 /= m;
+    a1 /= m;
+    
+    double denominator = a0 - 2.0 * a1;
+    if (!(a0 > 0.0) || !(denominator > 0.0)) {
+        throw std::runtime_error("Degenerate tail: the exceedances are all equal");
+    }
+    fit.shape = 2.0 - a0 / denominator;
+    fit.scale = 2.0 * a0 * a1 / denominator;
+    
+    return fit;
+}
+
+double EvtVaR::excessCdf(const GpdFit& fit, double y) {
+    if (y <= 0.0) {
+        return 0.0;
+    }
+    if (std::abs(fit.shape) < 1e-9) {
+        return 1.0 - std::exp(-y / fit.scale);
+    }
+    double base = 1.0 + fit.shape * y / fit.scale;
+    return base <= 0.0 ? 1.0 : 1.0 - std::pow(base, -1.0 / fit.shape);
+}
+
+double EvtVaR::tailVaR(const GpdFit& fit, double confidence) {
+    double alpha = 1.0 - confidence;
+    double exceedanceRate = static_cast<double>(fit.exceedances) / fit.observations;
+    if (alpha <= 0.0 || alpha > exceedanceRate) {
+        throw std::runtime_error("Confidence level must lie beyond the EVT threshold");
+    }
+    
+    // u + sigma/xi * ((alpha / (m/n))^-xi - 1), the exponential tail as xi -> 0
+    double ratio = alpha / exceedanceRate;
+    if (std::abs(fit.shape) < 1e-9) {
+        return fit.threshold - fit.scale * std::log(ratio);
+    }
+    return fit.threshold + fit.scale / fit.shape * (std::pow(ratio, -fit.shape) - 1.0);
+}
+
+double EvtVaR::tailES(const GpdFit& fit, double confidence) {
+    if (fit.shape >= 1.0) {
+        throw std::runtime_error("Tail too heavy for a finite ES (shape >= 1)");
+    }
+    
+    double var = tailVaR(fit, confidence);
+    return (var + fit.scale - fit.shape * fit.threshold) / (1.0 - fit.shape);
+}
@@ -0,0 +1,105 @@
+#include "fft.h"
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+const double PI = 3.14159265358979323846;
+
+size_t FFT::nextPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+void FFT::transform(std::vector<std::complex<double>>& data, bool inverse) {
+    size_t n = data.size();
+    if (n == 0 || (n & (n - 1)) != 0) {
+        throw std::runtime_error("FFT size must be a power of two");
+    }
+    
+    // Bit-reversal permutation
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+    
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = 2.0 * PI / static_cast<double>(len) * (inverse ? 1.0 : -1.0);
+        std::complex<double> wLen(std::cos(angle), std::sin(angle));
+        
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1.0, 0.0);
+            for (size_t k = 0; k < len / 2; ++k) {
+                std::complex<double> u = data[i + k];
+                std::complex<double> v = data[i + k + len / 2] * w;
+                data[i + k] = u + v;
+                data[i + k + len / 2] = u - v;
+                w *= wLen;
+            }
+        }
+    }
+    
+    if (inverse) {
+        for (auto& value : data) {
+            value /= static_cast<double>(n);
+        }
+    }
+}
+
+std::vector<double> FFT::convolve(const std::vector<double>& a, const std::vector<double>& b) {
+    if (a.empty() || b.empty()) {
+        return {};
+    }
+    
+    size_t outSize = a.size() + b.size() - 1;
+    std::vector<double> result(outSize, 0.0);
+    
+    // Direct convolution is cheaper for short kernels
+    if (std::min(a.size(), b.size()) <= 32) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            for (size_t j = 0; j < b.size(); ++j) {
+                result[i + j] += a[i] * b[j];
+            }
+        }
+        return result;
+    }
+    
+    size_t n = nextPowerOfTwo(outSize);
+    
+    // Pack both real inputs into one complex transform: z = a + i*b
+    std::vector<std::complex<double>> z(n);
+    for (size_t i = 0; i < a.size(); ++i) {
+        z[i].real(a[i]);
+    }
+    for (size_t i = 0; i < b.size(); ++i) {
+        z[i].imag(b[i]);
+    }
+    
+    transform(z);
+    
+    // A(k) = (Z(k) + conj(Z(n-k))) / 2, B(k) = (Z(k) - conj(Z(n-k))) / 2i
+    std::vector<std::complex<double>> product(n);
+    for (size_t k = 0; k < n; ++k) {
+        std::complex<double> zk = z[k];
+        std::complex<double> zn = std::conj(z[(n - k) & (n - 1)]);
+        std::complex<double> fa = 0.5 * (zk + zn);
+        std::complex<double> fb = std::complex<double>(0.0, -0.5) * (zk - zn);
+        product[k] = fa * fb;
+    }
+    
+    transform(product, true);
+    
+    for (size_t i = 0; i < outSize; ++i) {
+        result[i] = product[i].real();
+    }
+    
+    return result;
+}
@@ -0,0 +1,50 @@
+#include "filtered_historical_var.h"
+#include "profiler.h"
+#include <cmath>
+#include <stdexcept>
+
+FilteredHistoricalVaR::FilteredHistoricalVaR() = default;
+
+FilteredHistoricalVaR::FilteredHistoricalVaR(const GarchParams& start) : hasStart_(true), start_(start) {}
+
+double FilteredHistoricalVaR::calculateVaR(const ReturnSeries& returns, double confidence) {
+    return calculateRisk(returns, confidence).var;
+}
+
+double FilteredHistoricalVaR::calculateES(const ReturnSeries& returns, double confidence) {
+    return calculateRisk(returns, confidence).es;
+}
+
+RiskMeasures FilteredHistoricalVaR::calculateRisk(const ReturnSeries& returns, double confidence) {
+    return calculateRiskBatch(returns, {confidence}).front();
+}
+
+std::vector<RiskMeasures> FilteredHistoricalVaR::calculateRiskBatch(const ReturnSeries& returns,
+                                                                   const std::vector<double>& confidences) {
+    VAR_PROFILE_SCOPE("filtered.risk");
+    if (returns.empty()) {
+        throw std::runtime_error("Cannot calculate VaR with empty returns");
+    }
+    
+    // One fit and one scenario set for every level
+    return historical_.calculateRiskBatch(scenarios(returns, fit(returns)), confidences);
+}
+
+std::vector<double> FilteredHistoricalVaR::scenarios(const std::vector<double>& returns, const GarchFit& fit) {
+    std::vector<double> residuals(returns.size());
+    for (size_t t = 0; t < returns.size(); ++t) {
+        residuals[t] = returns[t] - fit.mean;
+    }
+    
+    std::vector<double> variance = Garch11::conditionalVariance(residuals, fit.params);
+    double forecast = std::sqrt(variance.back());
+    
+    for (size_t t = 0; t < residuals.size(); ++t) {
+        residuals[t] = fit.mean + forecast * residuals[t] / std::sqrt(variance[t]);
+    }
+    return residuals;
+}
+
+GarchFit FilteredHistoricalVaR::fit(const std::vector<double>& returns) const {
+    return hasStart_ ? Garch11::fit(returns, start_) : Garch11::fit(returns);
+}
@@ -0,0 +1,243 @@
+#include "garch.h"
+#include "parallel.h"
+#include "profiler.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+// The optimiser works on x = (omega / v, alpha, beta), with v the sample
+// variance, so all three coordinates are of order one
+using Vector3 = std::array<double, 3>;
+using Matrix3 = std::array<Vector3, 3>;
+
+const double GRADIENT_TOLERANCE = 1e-7;
+const double ARMIJO = 1e-4;
+const int MAX_HALVINGS = 40;
+
+double dot(const Vector3& a, const Vector3& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+Matrix3 identity() {
+    return {{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+}
+
+Vector3 project(Vector3 x) {
+    x[0] = std::max(x[0], 1e-8);
+    x[1] = std::max(x[1], 0.0);
+    x[2] = std::max(x[2], 0.0);
+    double persistence = x[1] + x[2];
+    if (persistence > Garch11::MAX_PERSISTENCE) {
+        x[1] *= Garch11::MAX_PERSISTENCE / persistence;
+        x[2] *= Garch11::MAX_PERSISTENCE / persistence;
+    }
+    return x;
+}
+
+// Largest component of the gradient that is not blocked by a bound
+double projectedGradientNorm(const Vector3& x, const Vector3& g) {
+    Vector3 stepped = project({x[0] - g[0], x[1] - g[1], x[2] - g[2]});
+    double norm = 0.0;
+    for (int i = 0; i < 3; ++i) {
+        norm = std::max(norm, std::abs(x[i] - stepped[i]));
+    }
+    return norm;
+}
+
+double meanSquare(const std::vector<double>& residuals) {
+    double sum = 0.0;
+    for (double e : residuals) {
+        sum += e * e;
+    }
+    return sum / residuals.size();
+}
+
+struct Objective {
+    const std::vector<double>& residuals;
+    double variance;
+
+    double operator()(const Vector3& x, Vector3& g) const {
+        GarchParams params{x[0] * variance, x[1], x[2]};
+        double gradient[3];
+        double f = Garch11::negativeLogLikelihood(residuals, params, gradient);
+        g = {gradient[0] * variance, gradient[1], gradient[2]};
+        return f;
+    }
+};
+
+} // namespace
+
+double GarchParams::longRunVariance() const {
+    return persistence() < 1.0 ? omega / (1.0 - persistence()) : std::numeric_limits<double>::infinity();
+}
+
+double Garch11::negativeLogLikelihood(const std::vector<double>& residuals, const GarchParams& params,
+                                      double* gradient) {
+    size_t n = residuals.size();
+    double h = meanSquare(residuals);
+    double dOmega = 0.0, dAlpha = 0.0, dBeta = 0.0;
+    double f = 0.0, gOmega = 0.0, gAlpha = 0.0, gBeta = 0.0;
+
+    for (size_t t = 0; t < n; ++t) {
+        if (t > 0) {
+            // dh[t]/dtheta = d(omega + alpha*e^2 + beta*h)/dtheta + beta*dh[t-1]/dtheta
+            double e2 = residuals[t - 1] * residuals[t - 1];
+            dOmega = 1.0 + params.beta * dOmega;
+            dAlpha = e2 + params.beta * dAlpha;
+            dBeta = h + params.beta * dBeta;
+            h = params.omega + params.alpha * e2 + params.beta * h;
+        }
+        if (!(h > 0.0)) {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        double ratio = residuals[t] * residuals[t] / h;
+        f += std::log(h) + ratio;
+
+        double weight = (1.0 - ratio) / h;
+        gOmega += weight * dOmega;
+        gAlpha += weight * dAlpha;
+        gBeta += weight * dBeta;
+    }
+
+    if (gradient) {
+        gradient[0] = 0.5 * gOmega / n;
+        gradient[1] = 0.5 * gAlpha / n;
+        gradient[2] = 0.5 * gBeta / n;
+    }
+    return 0.5 * f / n;
+}
+
+std::vector<double> Garch11::conditionalVariance(const std::vector<double>& residuals, const GarchParams& params) {
+    std::vector<double> h(residuals.size() + 1);
+    h[0] = residuals.empty() ? 0.0 : meanSquare(residuals);
+    for (size_t t = 0; t < residuals.size(); ++t) {
+        h[t + 1] = params.omega + params.alpha * residuals[t] * residuals[t] + params.beta * h[t];
+    }
+    return h;
+}
+
+GarchFit Garch11::fit(const std::vector<double>& returns) {
+    return fit(returns, GarchParams());
+}
+
+GarchFit Garch11::fit(const std::vector<double>& returns, const GarchParams& start) {
+    VAR_PROFILE_SCOPE("garch.fit");
+    if (returns.size() < MIN_OBSERVATIONS) {
+        throw std::runtime_error("GARCH fit needs at least " + std::to_string(MIN_OBSERVATIONS) + " returns");
+    }
+
+    GarchFit result;
+    result.mean = std::accumulate(returns.begin(), returns.end(), 0.0) / returns.size();
+    std::vector<double> residuals(returns.size());
+    for (size_t t = 0; t < returns.size(); ++t) {
+        residuals[t] = returns[t] - result.mean;
+    }
+
+    double variance = meanSquare(residuals);
+    if (!(variance > 0.0)) {
+        throw std::runtime_error("Cannot fit GARCH to a constant series");
+    }
+    Objective objective{residuals, variance};
+
+    // A start without omega (the default) targets the sample variance
+    double omega = start.omega > 0.0 ? start.omega : variance * (1.0 - start.persistence());
+    Vector3 x = project({omega / variance, start.alpha, start.beta});
+    Vector3 g;
+    double f = objective(x, g);
+    Matrix3 inverseHessian = identity();
+    bool freshHessian = true;
+
+    for (; result.iterations < MAX_ITERATIONS; ++result.iterations) {
+        if (projectedGradientNorm(x, g) < GRADIENT_TOLERANCE) {
+            result.converged = true;
+            break;
+        }
+
+        Vector3 direction;
+        for (int i = 0; i < 3; ++i) {
+            direction[i] = -dot(inverseHessian[i], g);
+        }
+        if (dot(direction, g) >= 0.0) {
+            inverseHessian = identity();
+            freshHessian = true;
+            direction = {-g[0], -g[1], -g[2]};
+        }
+
+        // Projected backtracking: halve the step until the decrease is sufficient
+        Vector3 next, nextGradient;
+        double nextF = f;
+        bool accepted = false;
+        double step = 1.0;
+        for (int k = 0; k < MAX_HALVINGS && !accepted; ++k, step *= 0.5) {
+            next = project({x[0] + step * direction[0], x[1] + step * direction[1], x[2] + step * direction[2]});
+            nextF = objective(next, nextGradient);
+            Vector3 moved = {next[0] - x[0], next[1] - x[1], next[2] - x[2]};
+            accepted = nextF <= f + ARMIJO * dot(g, moved);
+        }
+
+        if (!accepted) {
+            if (freshHessian) {
+                // No descent even along the gradient: at the optimum to machine precision
+                result.converged = true;
+                break;
+            }
+            inverseHessian = identity();
+            freshHessian = true;
+            continue;
+        }
+
+        Vector3 s = {next[0] - x[0], next[1] - x[1], next[2] - x[2]};
+        Vector3 y = {nextGradient[0] - g[0], nextGradient[1] - g[1], nextGradient[2] - g[2]};
+        double sy = dot(s, y);
+        if (sy > 1e-16) {
+            // H = (I - rho s y') H (I - rho y s') + rho s s'
+            double rho = 1.0 / sy;
+            Vector3 hy;
+            for (int i = 0; i < 3; ++i) {
+                hy[i] = dot(inverseHessian[i], y);
+            }
+            double yhy = dot(y, hy);
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    inverseHessian[i][j] += rho * ((1.0 + rho * yhy) * s[i] * s[j] - hy[i] * s[j] - s[i] * hy[j]);
+                }
+            }
+            freshHessian = false;
+        }
+
+        bool stalled = std::abs(f - nextF) <= 1e-15 * std::abs(f);
+        x = next;
+        f = nextF;
+        g = nextGradient;
+        if (stalled) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    VAR_PROFILE_COUNT("garch.iterations", result.iterations);
+
+    result.params = {x[0] * variance, x[1], x[2]};
+    result.logLikelihood = -f * returns.size();
+    return result;
+}
+
+std::vector<GarchFit> Garch11::fitBatch(const std::vector<std::vector<double>>& series,
+                                        const std::vector<GarchParams>& starts,
+                                        unsigned numThreads) {
+    if (!starts.empty() && starts.size() != series.size()) {
+        throw std::runtime_error("GARCH batch needs one warm start per series");
+    }
+
+    std::vector<GarchFit> fits(series.size());
+    Parallel::forEach(series.size(), numThreads, [&](size_t i, unsigned) {
+        fits[i] = starts.empty() ? fit(series[i]) : fit(series[i], starts[i]);
+    });
+    return fits;
+}
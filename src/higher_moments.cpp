@@ -0,0 +1,222 @@
+#include "higher_moments.h"
+#include "cpu_features.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "simd_math.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Chunks below this size are not worth a thread
+const size_t MIN_CHUNK = 1 << 16;
+
+// Power sums of (x - shift): sums[k] = sum (x - shift)^(k+1), k = 0..3
+void powerSumsScalar(const double* x, size_t n, double shift, double* sums) {
+    double s1 = 0.0, s2 = 0.0, s3 = 0.0, s4 = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double d = x[i] - shift;
+        double d2 = d * d;
+        s1 += d;
+        s2 += d2;
+        s3 += d2 * d;
+        s4 += d2 * d2;
+    }
+    sums[0] = s1;
+    sums[1] = s2;
+    sums[2] = s3;
+    sums[3] = s4;
+}
+
+#if VAR_X86_SIMD
+
+VAR_TARGET_AVX2 double horizontalSum256(__m256d v) {
+    __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+// Two independent sets of accumulators hide the FMA latency
+VAR_TARGET_AVX2 void powerSumsAvx2(const double* x, size_t n, double shift, double* sums) {
+    const __m256d s = _mm256_set1_pd(shift);
+    __m256d a1 = _mm256_setzero_pd(), a2 = a1, a3 = a1, a4 = a1;
+    __m256d b1 = a1, b2 = a1, b3 = a1, b4 = a1;
+    
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d da = _mm256_sub_pd(_mm256_loadu_pd(x + i), s);
+        __m256d db = _mm256_sub_pd(_mm256_loadu_pd(x + i + 4), s);
+        __m256d da2 = _mm256_mul_pd(da, da);
+        __m256d db2 = _mm256_mul_pd(db, db);
+        a1 = _mm256_add_pd(a1, da);
+        b1 = _mm256_add_pd(b1, db);
+        a2 = _mm256_add_pd(a2, da2);
+        b2 = _mm256_add_pd(b2, db2);
+        a3 = _mm256_fmadd_pd(da2, da, a3);
+        b3 = _mm256_fmadd_pd(db2, db, b3);
+        a4 = _mm256_fmadd_pd(da2, da2, a4);
+        b4 = _mm256_fmadd_pd(db2, db2, b4);
+    }
+    
+    double tail[4];
+    powerSumsScalar(x + i, n - i, shift, tail);
+    sums[0] = horizontalSum256(_mm256_add_pd(a1, b1)) + tail[0];
+    sums[1] = horizontalSum256(_mm256_add_pd(a2, b2)) + tail[1];
+    sums[2] = horizontalSum256(_mm256_add_pd(a3, b3)) + tail[2];
+    sums[3] = horizontalSum256(_mm256_add_pd(a4, b4)) + tail[3];
+}
+
+VAR_TARGET_AVX512 void powerSumsAvx512(const double* x, size_t n, double shift, double* sums) {
+    const __m512d s = _mm512_set1_pd(shift);
+    __m512d a1 = _mm512_setzero_pd(), a2 = a1, a3 = a1, a4 = a1;
+    __m512d b1 = a1, b2 = a1, b3 = a1, b4 = a1;
+    
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d da = _mm512_sub_pd(_mm512_loadu_pd(x + i), s);
+        __m512d db = _mm512_sub_pd(_mm512_loadu_pd(x + i + 8), s);
+        __m512d da2 = _mm512_mul_pd(da, da);
+        __m512d db2 = _mm512_mul_pd(db, db);
+        a1 = _mm512_add_pd(a1, da);
+        b1 = _mm512_add_pd(b1, db);
+        a2 = _mm512_add_pd(a2, da2);
+        b2 = _mm512_add_pd(b2, db2);
+        a3 = _mm512_fmadd_pd(da2, da, a3);
+        b3 = _mm512_fmadd_pd(db2, db, b3);
+        a4 = _mm512_fmadd_pd(da2, da2, a4);
+        b4 = _mm512_fmadd_pd(db2, db2, b4);
+    }
+    
+    double tail[4];
+    powerSumsScalar(x + i, n - i, shift, tail);
+    sums[0] = _mm512_reduce_add_pd(_mm512_add_pd(a1, b1)) + tail[0];
+    sums[1] = _mm512_reduce_add_pd(_mm512_add_pd(a2, b2)) + tail[1];
+    sums[2] = _mm512_reduce_add_pd(_mm512_add_pd(a3, b3)) + tail[2];
+    sums[3] = _mm512_reduce_add_pd(_mm512_add_pd(a4, b4)) + tail[3];
+}
+
+#endif // VAR_X86_SIMD
+
+void powerSums(const double* x, size_t n, double shift, double* sums) {
+#if VAR_X86_SIMD
+    if (CpuFeatures::hasAvx512()) {
+        powerSumsAvx512(x, n, shift, sums);
+        return;
+    }
+    if (CpuFeatures::hasAvx2()) {
+        powerSumsAvx2(x, n, shift, sums);
+        return;
+    }
+#endif
+    powerSumsScalar(x, n, shift, sums);
+}
+
+} // namespace
+
+void HigherMoments::add(double x) {
+    HigherMoments single;
+    single.count_ = 1;
+    single.mean_ = x;
+    merge(single);
+}
+
+void HigherMoments::add(const double* data, size_t n) {
+    VAR_PROFILE_COUNT("moments.elements", n);
+    
+    for (size_t start = 0; start < n; start += BLOCK_SIZE) {
+        size_t length = std::min(BLOCK_SIZE, n - start);
+        const double* block = data + start;
+        
+        // Deviations are taken around the running mean (the first block's
+        // own mean to begin with) so the power sums do not cancel
+        double shift = mean_;
+        if (count_ == 0) {
+            double sums[4];
+            powerSumsScalar(block, length, 0.0, sums);
+            shift = sums[0] / length;
+        }
+        
+        double sums[4];
+        powerSums(block, length, shift, sums);
+        
+        // Central moments of the block from its shifted power sums
+        double b = static_cast<double>(length);
+        double m = sums[0] / b;
+        HigherMoments part;
+        part.count_ = length;
+        part.mean_ = shift + m;
+        part.m2_ = std::max(0.0, sums[1] - m * sums[0]);
+        part.m3_ = sums[2] - 3.0 * m * sums[1] + 2.0 * b * m * m * m;
+        part.m4_ = std::max(0.0, sums[3] - 4.0 * m * sums[2] + 6.0 * m * m * sums[1] - 3.0 * b * m * m * m * m);
+        merge(part);
+    }
+}
+
+void HigherMoments::merge(const HigherMoments& other) {
+    if (other.count_ == 0) return;
+    if (count_ == 0) {
+        *this = other;
+        return;
+    }
+    
+    double na = static_cast<double>(count_);
+    double nb = static_cast<double>(other.count_);
+    double n = na + nb;
+    double delta = other.mean_ - mean_;
+    double delta2 = delta * delta;
+    
+    double m4 = m4_ + other.m4_
+              + delta2 * delta2 * na * nb * (na * na - na * nb + nb * nb) / (n * n * n)
+              + 6.0 * delta2 * (na * na * other.m2_ + nb * nb * m2_) / (n * n)
+              + 4.0 * delta * (na * other.m3_ - nb * m3_) / n;
+    double m3 = m3_ + other.m3_
+              + delta2 * delta * na * nb * (na - nb) / (n * n)
+              + 3.0 * delta * (na * other.m2_ - nb * m2_) / n;
+    
+    m2_ += other.m2_ + delta2 * na * nb / n;
+    m3_ = m3;
+    m4_ = m4;
+    mean_ += delta * nb / n;
+    count_ += other.count_;
+}
+
+double HigherMoments::variance() const {
+    return count_ > 1 ? m2_ / (count_ - 1) : 0.0;
+}
+
+double HigherMoments::stdDev() const {
+    return std::sqrt(variance());
+}
+
+double HigherMoments::skewness() const {
+    if (count_ < 2 || m2_ <= 0.0) return 0.0;
+    return std::sqrt(static_cast<double>(count_)) * m3_ / std::pow(m2_, 1.5);
+}
+
+double HigherMoments::excessKurtosis() const {
+    if (count_ < 2 || m2_ <= 0.0) return 0.0;
+    return static_cast<double>(count_) * m4_ / (m2_ * m2_) - 3.0;
+}
+
+HigherMoments HigherMoments::of(const std::vector<double>& data, unsigned numThreads) {
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(Parallel::resolveThreads(numThreads),
+                                                         data.size() / MIN_CHUNK));
+    if (chunks == 1) {
+        HigherMoments moments;
+        moments.add(data.data(), data.size());
+        return moments;
+    }
+    
+    std::vector<HigherMoments> parts(chunks);
+    size_t chunkSize = (data.size() + chunks - 1) / chunks;
+    Parallel::forEach(chunks, static_cast<unsigned>(chunks), [&](size_t c, unsigned) {
+        size_t begin = c * chunkSize;
+        size_t end = std::min(data.size(), begin + chunkSize);
+        parts[c].add(data.data() + begin, end - begin);
+    });
+    
+    HigherMoments moments;
+    for (const auto& part : parts) {
+        moments.merge(part);
+    }
+    return moments;
+}
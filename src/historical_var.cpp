@@ -1,34 +1,92 @@
 #include "historical_var.h"
+#include "profiler.h"
+#include "tail_selection.h"
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
 
-double HistoricalVaR::calculateVaR(const std::vector<double>& returns, double confidence) {
+double HistoricalVaR::calculateVaR(const ReturnSeries& returns, double confidence) {
+    VAR_PROFILE_SCOPE("historical.var");
     if (returns.empty()) {
         throw std::runtime_error("Cannot calculate VaR with empty returns");
     }
     
-    std::vector<double> sorted = sortedCopy(returns);
+    auto tail = returns.lowest(quantileTailSize(returns.size(), confidence));
     
-    double alpha = 1.0 - confidence;
-    double index = alpha * (sorted.size() - 1);
+    return -interpolatedQuantile(*tail, confidence);
+}
+
+double HistoricalVaR::calculateES(const ReturnSeries& returns, double confidence) {
+    VAR_PROFILE_SCOPE("historical.es");
+    if (returns.empty()) {
+        throw std::runtime_error("Cannot calculate ES with empty returns");
+    }
+    
+    return expectedShortfall(returns, confidence);
+}
+
+RiskMeasures HistoricalVaR::calculateRisk(const ReturnSeries& returns, double confidence) {
+    return calculateRiskBatch(returns, {confidence}).front();
+}
+
+std::vector<RiskMeasures> HistoricalVaR::calculateRiskBatch(const ReturnSeries& returns,
+                                                           const std::vector<double>& confidences) {
+    VAR_PROFILE_SCOPE("historical.risk");
+    if (returns.empty()) {
+        throw std::runtime_error("Cannot calculate VaR with empty returns");
+    }
+    
+    // One selection of the widest tail any level needs, shared through the series
+    size_t tailSize = 1;
+    for (double confidence : confidences) {
+        tailSize = std::max({tailSize, quantileTailSize(returns.size(), confidence),
+                             TailSelection::esTailCount(returns.size(), 1.0 - confidence)});
+    }
+    auto tail = returns.lowest(tailSize);
+    
+    std::vector<RiskMeasures> results;
+    results.reserve(confidences.size());
+    for (double confidence : confidences) {
+        RiskMeasures risk = summarizeTail(*tail, confidence);
+        risk.var = -interpolatedQuantile(*tail, confidence);
+        results.push_back(risk);
+    }
+    
+    return results;
+}
+
+RiskMeasures HistoricalVaR::calculateRiskInPlace(std::vector<double>& sample, double confidence) {
+    if (sample.empty()) {
+        throw std::runtime_error("Cannot calculate VaR with empty returns");
+    }
+    
+    TailSelection::selectLowest(sample, std::max(quantileTailSize(sample.size(), confidence),
+                                                 TailSelection::esTailCount(sample.size(), 1.0 - confidence)));
+    
+    RiskMeasures risk = summarizeTail(sample, confidence);
+    risk.var = -interpolatedQuantile(sample, confidence);
+    return risk;
+}
+
+double HistoricalVaR::interpolatedQuantile(const std::vector<double>& sorted, double confidence) {
+    double index = quantilePosition(sorted.size(), confidence);
     
     size_t lower = static_cast<size_t>(std::floor(index));
     size_t upper = static_cast<size_t>(std::ceil(index));
     
     if (lower == upper) {
-        return -sorted[lower];
+        return sorted[lower];
     }
     
     double weight = index - lower;
-    double var = sorted[lower] * (1.0 - weight) + sorted[upper] * weight;
-    
-    return -var;
+    return sorted[lower] * (1.0 - weight) + sorted[upper] * weight;
 }
 
-double HistoricalVaR::calculateES(const std::vector<double>& returns, double confidence) {
-    if (returns.empty()) {
-        throw std::runtime_error("Cannot calculate ES with empty returns");
-    }
-    
-    return expectedShortfall(returns, confidence);
+size_t HistoricalVaR::quantileTailSize(size_t n, double confidence) {
+    return static_cast<size_t>(std::ceil(quantilePosition(n, confidence))) + 1;
+}
+
+double HistoricalVaR::quantilePosition(size_t n, double confidence) {
+    double alpha = 1.0 - confidence;
+    return alpha * (n - 1);
 }
@@ -0,0 +1,299 @@
+#include "kde_cdf.h"
+#include "profiler.h"
+#include "fft.h"
+#include "special_functions.h"
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+// Kernel terms are evaluated in stack-sized batches
+const size_t KERNEL_BATCH = 256;
+
+// Sum of kernel((x - data[i]) / bandwidth) over count points, where kernel
+// is one of the batched normal functions
+template <typename Kernel>
+double kernelSum(const double* data, size_t count, double x, double bandwidth, Kernel kernel) {
+    double buffer[KERNEL_BATCH];
+    double sum = 0.0;
+    for (size_t start = 0; start < count; start += KERNEL_BATCH) {
+        size_t m = std::min(KERNEL_BATCH, count - start);
+        for (size_t j = 0; j < m; ++j) {
+            buffer[j] = (x - data[start + j]) / bandwidth;
+        }
+        kernel(buffer, buffer, m);
+        for (size_t j = 0; j < m; ++j) {
+            sum += buffer[j];
+        }
+    }
+    return sum;
+}
+
+// Sum of x_i Phi(u_i) - h phi(u_i), u_i = (x - x_i) / h, over count points
+double partialMeanSum(const double* data, size_t count, double x, double bandwidth) {
+    double u[KERNEL_BATCH];
+    double cdf[KERNEL_BATCH];
+    double pdf[KERNEL_BATCH];
+    double sum = 0.0;
+    for (size_t start = 0; start < count; start += KERNEL_BATCH) {
+        size_t m = std::min(KERNEL_BATCH, count - start);
+        for (size_t j = 0; j < m; ++j) {
+            u[j] = (x - data[start + j]) / bandwidth;
+        }
+        SpecialFunctions::normalCdf(u, cdf, m);
+        SpecialFunctions::normalPdf(u, pdf, m);
+        for (size_t j = 0; j < m; ++j) {
+            sum += data[start + j] * cdf[j] - bandwidth * pdf[j];
+        }
+    }
+    return sum;
+}
+
+} // namespace
+
+KdeCdf::KdeCdf(std::vector<double> data, double bandwidth, Mode mode, size_t gridSize)
+    : data_(std::move(data)), bandwidth_(bandwidth), mode_(mode) {
+    if (data_.empty()) {
+        throw std::runtime_error("Cannot build a kernel density from empty data");
+    }
+    if (!(bandwidth_ > 0.0)) {
+        throw std::runtime_error("Kernel bandwidth must be positive");
+    }
+    
+    if (mode_ == Mode::Exact) {
+        // The cutoff window is located by binary search over the sorted sample
+        if (!std::is_sorted(data_.begin(), data_.end())) {
+            std::sort(data_.begin(), data_.end());
+        }
+        minValue_ = data_.front();
+        maxValue_ = data_.back();
+    } else {
+        auto range = std::minmax_element(data_.begin(), data_.end());
+        minValue_ = *range.first;
+        maxValue_ = *range.second;
+        buildTable(std::max<size_t>(gridSize, 2));
+    }
+}
+
+double KdeCdf::cdf(double x) const {
+    return mode_ == Mode::Exact ? exactCdf(x) : tableCdf(x);
+}
+
+double KdeCdf::pdf(double x) const {
+    return mode_ == Mode::Exact ? exactPdf(x) : tablePdf(x);
+}
+
+double KdeCdf::quantile(double probability) const {
+    if (!(probability > 0.0 && probability < 1.0)) {
+        throw std::runtime_error("Quantile probability must be in (0, 1)");
+    }
+    return mode_ == Mode::Exact ? exactQuantile(probability) : tableQuantile(probability);
+}
+
+double KdeCdf::partialMean(double x) const {
+    VAR_PROFILE_SCOPE("kde.partial_mean");
+    double reach = CUTOFF * bandwidth_;
+    double full = 0.0;
+    double window = 0.0;
+    
+    if (mode_ == Mode::Exact) {
+        // Sorted: the full contributions are a prefix, the window follows it
+        auto first = std::lower_bound(data_.begin(), data_.end(), x - reach);
+        auto last = std::upper_bound(first, data_.end(), x + reach);
+        VAR_PROFILE_COUNT("kde.kernel_terms", last - first);
+        
+        full = std::accumulate(data_.begin(), first, 0.0);
+        window = partialMeanSum(data_.data() + (first - data_.begin()), last - first, x, bandwidth_);
+    } else {
+        // One pass over the unsorted sample, batching the points in the window
+        double pending[KERNEL_BATCH];
+        size_t count = 0;
+        size_t terms = 0;
+        for (double xi : data_) {
+            if (xi < x - reach) {
+                full += xi;
+            } else if (xi <= x + reach) {
+                pending[count++] = xi;
+                if (count == KERNEL_BATCH) {
+                    window += partialMeanSum(pending, count, x, bandwidth_);
+                    terms += count;
+                    count = 0;
+                }
+            }
+        }
+        window += partialMeanSum(pending, count, x, bandwidth_);
+        VAR_PROFILE_COUNT("kde.kernel_terms", terms + count);
+    }
+    
+    return (full + window) / data_.size();
+}
+
+double KdeCdf::exactCdf(double x) const {
+    double reach = CUTOFF * bandwidth_;
+    
+    // Points far below x contribute a full unit, points far above contribute nothing
+    auto first = std::lower_bound(data_.begin(), data_.end(), x - reach);
+    auto last = std::upper_bound(first, data_.end(), x + reach);
+    
+    VAR_PROFILE_COUNT("kde.cdf_evaluations", 1);
+    VAR_PROFILE_COUNT("kde.kernel_terms", last - first);
+    
+    const double* window = data_.data() + (first - data_.begin());
+    double sum = static_cast<double>(first - data_.begin());
+    sum += kernelSum(window, last - first, x, bandwidth_, [](const double* in, double* out, size_t m) {
+        SpecialFunctions::normalCdf(in, out, m);
+    });
+    
+    return sum / data_.size();
+}
+
+double KdeCdf::exactPdf(double x) const {
+    double reach = CUTOFF * bandwidth_;
+    
+    auto first = std::lower_bound(data_.begin(), data_.end(), x - reach);
+    auto last = std::upper_bound(first, data_.end(), x + reach);
+    
+    VAR_PROFILE_COUNT("kde.pdf_evaluations", 1);
+    VAR_PROFILE_COUNT("kde.kernel_terms", last - first);
+    
+    const double* window = data_.data() + (first - data_.begin());
+    double sum = kernelSum(window, last - first, x, bandwidth_, [](const double* in, double* out, size_t m) {
+        SpecialFunctions::normalPdf(in, out, m);
+    });
+    
+    return sum / (data_.size() * bandwidth_);
+}
+
+double KdeCdf::exactQuantile(double probability) const {
+    double left = minValue_ - CUTOFF * bandwidth_;
+    double right = maxValue_ + CUTOFF * bandwidth_;
+    
+    // Start Newton from the empirical quantile, which is already close
+    size_t index = static_cast<size_t>(probability * data_.size());
+    double x = data_[std::min(index, data_.size() - 1)];
+    
+    const double tolerance = 1e-10 * bandwidth_;
+    const int maxIterations = 100;
+    
+    for (int iter = 0; iter < maxIterations; ++iter) {
+        double error = exactCdf(x) - probability;
+        if (std::abs(error) < 1e-15) {
+            return x;
+        }
+        
+        if (error < 0.0) {
+            left = x;
+        } else {
+            right = x;
+        }
+        
+        // Fall back to bisection whenever Newton leaves the bracket
+        double density = exactPdf(x);
+        double next = density > 0.0 ? x - error / density : left;
+        if (!(next > left && next < right)) {
+            next = 0.5 * (left + right);
+        }
+        
+        if (std::abs(next - x) < tolerance) {
+            return next;
+        }
+        x = next;
+    }
+    
+    return x;
+}
+
+void KdeCdf::buildTable(size_t gridSize) {
+    VAR_PROFILE_SCOPE("kde.table");
+    VAR_PROFILE_COUNT("kde.table_points", gridSize);
+    double reach = CUTOFF * bandwidth_;
+    gridStart_ = minValue_ - reach;
+    gridStep_ = (maxValue_ + reach - gridStart_) / (gridSize - 1);
+    
+    // Linear binning onto the grid
+    std::vector<double> weights(gridSize, 0.0);
+    for (double xi : data_) {
+        double pos = (xi - gridStart_) / gridStep_;
+        size_t j = std::min(static_cast<size_t>(pos), gridSize - 2);
+        double frac = pos - j;
+        weights[j] += 1.0 - frac;
+        weights[j + 1] += frac;
+    }
+    
+    // Kernel CDF sampled at grid offsets; beyond the cutoff it is exactly 0 or 1
+    size_t halfWidth = std::min(gridSize - 1,
+                                static_cast<size_t>(std::ceil(reach / gridStep_)));
+    std::vector<double> kernel(2 * halfWidth + 1);
+    for (size_t i = 0; i < kernel.size(); ++i) {
+        double offset = (static_cast<double>(i) - static_cast<double>(halfWidth)) * gridStep_;
+        kernel[i] = offset / bandwidth_;
+    }
+    SpecialFunctions::normalCdf(kernel.data(), kernel.data(), kernel.size());
+    
+    std::vector<double> smoothed = FFT::convolve(weights, kernel);
+    
+    cdfTable_.assign(gridSize, 0.0);
+    double fullMass = 0.0;
+    double n = static_cast<double>(data_.size());
+    double running = 0.0;
+    
+    for (size_t j = 0; j < gridSize; ++j) {
+        // Bins more than halfWidth below j contribute their whole weight
+        if (j > halfWidth) {
+            fullMass += weights[j - halfWidth - 1];
+        }
+        double value = (fullMass + smoothed[j + halfWidth]) / n;
+        
+        // Clamp FFT round-off so the table stays a valid CDF
+        running = std::max(running, std::min(1.0, std::max(0.0, value)));
+        cdfTable_[j] = running;
+    }
+}
+
+double KdeCdf::tableCdf(double x) const {
+    double pos = (x - gridStart_) / gridStep_;
+    if (pos <= 0.0) return cdfTable_.front();
+    if (pos >= cdfTable_.size() - 1) return cdfTable_.back();
+    
+    size_t j = static_cast<size_t>(pos);
+    double frac = pos - j;
+    return cdfTable_[j] * (1.0 - frac) + cdfTable_[j + 1] * frac;
+}
+
+double KdeCdf::tablePdf(double x) const {
+    double pos = (x - gridStart_) / gridStep_;
+    if (pos < 0.0 || pos >= cdfTable_.size() - 1) return 0.0;
+    
+    size_t j = static_cast<size_t>(pos);
+    return (cdfTable_[j + 1] - cdfTable_[j]) / gridStep_;
+}
+
+double KdeCdf::tableQuantile(double probability) const {
+    auto it = std::lower_bound(cdfTable_.begin(), cdfTable_.end(), probability);
+    if (it == cdfTable_.begin()) {
+        return gridStart_;
+    }
+    if (it == cdfTable_.end()) {
+        return gridStart_ + gridStep_ * (cdfTable_.size() - 1);
+    }
+    
+    size_t j = static_cast<size_t>(it - cdfTable_.begin());
+    double lower = cdfTable_[j - 1];
+    double upper = cdfTable_[j];
+    double frac = upper > lower ? (probability - lower) / (upper - lower) : 0.0;
+    
+    return gridStart_ + gridStep_ * (static_cast<double>(j - 1) + frac);
+}
+
+bool KdeCdf::parseMode(const std::string& name, Mode& mode) {
+    if (name == "exact") {
+        mode = Mode::Exact;
+    } else if (name == "binned") {
+        mode = Mode::Binned;
+    } else {
+        return false;
+    }
+    return true;
+}
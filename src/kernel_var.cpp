@@ -1,128 +1,91 @@
 #include "kernel_var.h"
+#include "profiler.h"
 #include <cmath>
 #include <algorithm>
 #include <stdexcept>
-#include <random>
 
-const double PI = 3.14159265358979323846;
+KernelVaR::KernelVaR(double bandwidth, KdeCdf::Mode mode) : bandwidth_(bandwidth), mode_(mode) {}
 
-KernelVaR::KernelVaR(double bandwidth) : bandwidth_(bandwidth) {}
+KernelVaR::KernelVaR(BandwidthSelector::Rule rule, KdeCdf::Mode mode) : bandwidth_(-1.0), rule_(rule), mode_(mode) {}
 
-double KernelVaR::calculateVaR(const std::vector<double>& returns, double confidence) {
+double KernelVaR::calculateVaR(const ReturnSeries& returns, double confidence) {
+    VAR_PROFILE_SCOPE("kernel.var");
     if (returns.empty()) {
         throw std::runtime_error("Cannot calculate VaR with empty returns");
     }
     
-    double h = bandwidth_;
-    if (h <= 0) {
-        h = calculateOptimalBandwidth(returns);
-    }
-    
-    std::vector<double> sorted = sortedCopy(returns);
+    KdeCdf cdf(kdeSample(returns), resolveBandwidth(returns), mode_);
     
-    double var = findQuantile(sorted, h, confidence);
+    double var = findQuantile(cdf, confidence);
     
     return -var;
 }
 
-double KernelVaR::calculateES(const std::vector<double>& returns, double confidence) {
+double KernelVaR::calculateES(const ReturnSeries& returns, double confidence) {
+    VAR_PROFILE_SCOPE("kernel.es");
     if (returns.empty()) {
         throw std::runtime_error("Cannot calculate ES with empty returns");
     }
     
-    double h = bandwidth_;
-    if (h <= 0) {
-        h = calculateOptimalBandwidth(returns);
-    }
-    
-    const size_t numSamples = 5000;
-    std::vector<double> simulated;
-    simulated.reserve(numSamples);
-    
-    std::mt19937 gen(std::random_device{}());
-    std::normal_distribution<double> noise(0.0, h);
-    std::uniform_int_distribution<size_t> pick(0, returns.size() - 1);
+    KdeCdf cdf(kdeSample(returns), resolveBandwidth(returns), mode_);
     
-    for (size_t i = 0; i < numSamples; ++i) {
-        double base = returns[pick(gen)];
-        simulated.push_back(base + noise(gen));
-    }
-    
-    return expectedShortfall(simulated, confidence);
+    return riskAt(cdf, confidence).es;
 }
 
-double KernelVaR::gaussianKernel(double x) const {
-    return (1.0 / std::sqrt(2.0 * PI)) * std::exp(-0.5 * x * x);
+RiskMeasures KernelVaR::calculateRisk(const ReturnSeries& returns, double confidence) {
+    return calculateRiskBatch(returns, {confidence}).front();
 }
 
-double KernelVaR::estimatePDF(double x, const std::vector<double>& data, double h) const {
-    double sum = 0.0;
-    int n = data.size();
+std::vector<RiskMeasures> KernelVaR::calculateRiskBatch(const ReturnSeries& returns,
+                                                       const std::vector<double>& confidences) {
+    VAR_PROFILE_SCOPE("kernel.risk");
+    if (returns.empty()) {
+        throw std::runtime_error("Cannot calculate VaR with empty returns");
+    }
+    if (confidences.empty()) {
+        return {};
+    }
     
-    for (double xi : data) {
-        sum += gaussianKernel((x - xi) / h);
+    // One bandwidth and one CDF shared by every level
+    KdeCdf cdf(kdeSample(returns), resolveBandwidth(returns), mode_);
+    
+    std::vector<RiskMeasures> risks;
+    risks.reserve(confidences.size());
+    for (double confidence : confidences) {
+        risks.push_back(riskAt(cdf, confidence));
     }
     
-    return sum / (n * h);
+    return risks;
 }
 
-double KernelVaR::calculateOptimalBandwidth(const std::vector<double>& data) const {
-    // Silverman's rule of thumb
-    double sigma = standardDeviation(data);
-    int n = data.size();
-    
-    // h = 1.06 * sigma * n^(-1/5)
-    return 1.06 * sigma * std::pow(n, -0.2);
+double KernelVaR::resolveBandwidth(const ReturnSeries& returns) const {
+    // Every rule's bandwidth is cached on the series, so VaR and ES calls
+    // on the same returns select it once
+    return bandwidth_ > 0 ? bandwidth_ : BandwidthSelector::select(returns, rule_);
+}
+
+const std::vector<double>& KernelVaR::kdeSample(const ReturnSeries& returns) const {
+    // Exact mode needs the sample sorted; the series sorts it once for everyone
+    return mode_ == KdeCdf::Mode::Exact ? returns.sorted() : returns.values();
 }
 
-double KernelVaR::findQuantile(const std::vector<double>& sortedData, double bandwidth, double confidence) const {
+double KernelVaR::findQuantile(const KdeCdf& cdf, double confidence) const {
+    VAR_PROFILE_SCOPE("kernel.quantile");
     double targetProb = 1.0 - confidence;
     
-    double minVal = sortedData.front();
-    double maxVal = sortedData.back();
-    double range = maxVal - minVal;
-    
-    minVal -= 3.0 * bandwidth;
-    maxVal += 3.0 * bandwidth;
-    
-    double left = minVal;
-    double right = maxVal;
-    const double tolerance = 1e-6;
-    const int maxIterations = 100;
-    
-    for (int iter = 0; iter < maxIterations; ++iter) {
-        double mid = (left + right) / 2.0;
-        
-        double cumulativeProb = 0.0;
-        int numSteps = 1000;
-        double step = (mid - minVal) / numSteps;
-        
-        for (int i = 0; i <= numSteps; ++i) {
-            double x = minVal + i * step;
-            double pdf = estimatePDF(x, sortedData, bandwidth);
-            
-            if (i == 0 || i == numSteps) {
-                cumulativeProb += 0.5 * pdf * step;
-            } else {
-                cumulativeProb += pdf * step;
-            }
-        }
-        
-        if (std::abs(cumulativeProb - targetProb) < tolerance) {
-            return mid;
-        }
-        
-        if (cumulativeProb < targetProb) {
-            left = mid;
-        } else {
-            right = mid;
-        }
-    }
-    
-    size_t index = static_cast<size_t>(targetProb * sortedData.size());
-    if (index >= sortedData.size()) {
-        index = sortedData.size() - 1;
+    return cdf.quantile(targetProb);
+}
+
+RiskMeasures KernelVaR::riskAt(const KdeCdf& cdf, double confidence) const {
+    double alpha = 1.0 - confidence;
+    if (alpha <= 0.0) {
+        throw std::runtime_error("Confidence level must be less than 1.0");
     }
     
-    return sortedData[index];
+    // ES = -E[X; X <= q] / alpha, in closed form at the KDE quantile q
+    RiskMeasures risk;
+    double quantile = findQuantile(cdf, confidence);
+    risk.var = -quantile;
+    risk.es = -cdf.partialMean(quantile) / alpha;
+    return risk;
 }
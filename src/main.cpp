@@ -1,16 +1,25 @@
 #include <iostream>
+#include <cstdlib>
 #include <iomanip>
 #include <memory>
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <fstream>
+#include <sstream>
 
 #include "csv_parser.h"
+#include "return_cache.h"
 #include "historical_var.h"
+#include "filtered_historical_var.h"
 #include "parametric_var.h"
+#include "cornish_fisher_var.h"
 #include "monte_carlo_var.h"
 #include "kernel_var.h"
+#include "evt_var.h"
 #include "backtesting.h"
+#include "stream_monitor.h"
+#include "profiler.h"
 
 void printHeader() {
     std::cout << "\n";
@@ -22,7 +31,7 @@ void printHeader() {
 }
 
 void printVaRResults(const std::vector<std::unique_ptr<VarCalculator>>& calculators, 
-                     const std::vector<double>& returns, 
+                     const ReturnSeries& returns,
                      double confidence) {
     
     std::cout << "Confidence Level: " << (confidence * 100) << "%\n";
@@ -35,42 +44,221 @@ void printVaRResults(const std::vector<std::unique_ptr<VarCalculator>>& calculat
               << std::setw(15) << "Exceedance Rate (%)" << "\n";
     std::cout << std::string(75, '-') << "\n";
     
+    std::vector<std::string> notes;
+    std::vector<RiskMeasures> risks(calculators.size());
+    std::vector<std::string> errors(calculators.size());
+    
+    for (size_t m = 0; m < calculators.size(); ++m) {
+        try {
+            risks[m] = calculators[m]->calculateRisk(returns, confidence);
+        } catch (const std::exception& e) {
+            errors[m] = e.what();
+        }
+    }
+    
+    // All methods backtested in one pass over the returns
+    std::vector<std::vector<double>> thresholds;
+    for (const auto& risk : risks) {
+        thresholds.push_back({risk.var});
+    }
+    ExceedanceMatrix exceedances = Backtesting::countExceedances(returns, thresholds);
+    
+    for (size_t m = 0; m < calculators.size(); ++m) {
+        const auto& calculator = calculators[m];
+        if (!errors[m].empty()) {
+            std::cout << std::left << std::setw(30) << calculator->getMethodName()
+                      << std::right << std::setw(30) << "Error: " << errors[m] << "\n";
+            continue;
+        }
+        
+        const RiskMeasures& risk = risks[m];
+        double varPercent = risk.var * 100;
+        double esPercent = risk.es * 100;
+        
+        std::cout << std::left << std::setw(30) << calculator->getMethodName()
+                  << std::right << std::setw(15) << std::fixed << std::setprecision(2) << varPercent << "%"
+                  << std::setw(15) << std::fixed << std::setprecision(2) << esPercent << "%"
+                  << std::setw(15) << std::fixed << std::setprecision(2) << exceedances.rate(m, 0)*100 << "%\n";
+        
+        if (risk.varStandardError > 0.0) {
+            std::ostringstream note;
+            note << calculator->getMethodName() << " standard error: VaR +/- "
+                 << std::fixed << std::setprecision(4) << risk.varStandardError * 100 << "%, ES +/- "
+                 << risk.esStandardError * 100 << "%";
+            notes.push_back(note.str());
+        }
+    }
+    
+    std::cout << std::string(75, '-') << "\n";
+    for (const auto& note : notes) {
+        std::cout << note << "\n";
+    }
+    std::cout << "\n";
+}
+
+void printMultiLevelResults(const std::vector<std::unique_ptr<VarCalculator>>& calculators,
+                           const ReturnSeries& returns,
+                           const std::vector<double>& confidences) {
+    
+    std::cout << "Number of observations: " << returns.size() << "\n";
+    std::cout << "\n";
+    std::cout << std::string(90, '-') << "\n";
+    std::cout << std::left << std::setw(30) << "Method"
+              << std::right << std::setw(15) << "Confidence (%)"
+              << std::setw(15) << "VaR (%)"
+              << std::setw(15) << "ES (%)"
+              << std::setw(15) << "Exceedance (%)" << "\n";
+    std::cout << std::string(90, '-') << "\n";
+    
+    // Each method sorts or simulates once for every level
+    std::vector<std::vector<RiskMeasures>> risks(calculators.size());
+    std::vector<std::string> errors(calculators.size());
+    std::vector<std::vector<double>> thresholds;
+    
+    for (size_t m = 0; m < calculators.size(); ++m) {
+        try {
+            risks[m] = calculators[m]->calculateRiskBatch(returns, confidences);
+        } catch (const std::exception& e) {
+            errors[m] = e.what();
+            risks[m].assign(confidences.size(), RiskMeasures());
+        }
+        
+        thresholds.emplace_back();
+        for (const auto& risk : risks[m]) {
+            thresholds.back().push_back(risk.var);
+        }
+    }
+    
+    // Every method and level backtested in one pass over the returns
+    ExceedanceMatrix exceedances = Backtesting::countExceedances(returns, thresholds);
+    
+    for (size_t m = 0; m < calculators.size(); ++m) {
+        if (!errors[m].empty()) {
+            std::cout << std::left << std::setw(30) << calculators[m]->getMethodName()
+                      << std::right << std::setw(30) << "Error: " << errors[m] << "\n";
+            continue;
+        }
+        
+        for (size_t i = 0; i < confidences.size(); ++i) {
+            std::cout << std::left << std::setw(30) << (i == 0 ? calculators[m]->getMethodName() : "")
+                      << std::right << std::setw(14) << std::fixed << std::setprecision(2) << confidences[i] * 100 << "%"
+                      << std::setw(14) << std::fixed << std::setprecision(2) << risks[m][i].var * 100 << "%"
+                      << std::setw(14) << std::fixed << std::setprecision(2) << risks[m][i].es * 100 << "%"
+                      << std::setw(14) << std::fixed << std::setprecision(2) << exceedances.rate(m, i) * 100 << "%\n";
+        }
+    }
+    
+    std::cout << std::string(90, '-') << "\n";
+    std::cout << "\n";
+}
+
+void printBootstrapIntervals(const std::vector<std::unique_ptr<VarCalculator>>& calculators,
+                             const ReturnSeries& returns,
+                             double confidence,
+                             const BootstrapOptions& options) {
+    
+    std::cout << "Confidence Level: " << (confidence * 100) << "%\n";
+    std::cout << "Number of observations: " << returns.size() << "\n";
+    std::cout << "Bootstrap: " << options.resamples << " resamples, "
+              << std::fixed << std::setprecision(0) << options.level * 100 << "% percentile intervals\n";
+    std::cout << "\n";
+    std::cout << std::string(90, '-') << "\n";
+    std::cout << std::left << std::setw(30) << "Method"
+              << std::right << std::setw(10) << "VaR (%)"
+              << std::setw(20) << "VaR interval (%)"
+              << std::setw(10) << "ES (%)"
+              << std::setw(20) << "ES interval (%)" << "\n";
+    std::cout << std::string(90, '-') << "\n";
+    
+    size_t blockLength = 1;
     for (const auto& calculator : calculators) {
         try {
-            double var = calculator->calculateVaR(returns, confidence);
-            double varPercent = var * 100;
-            double es = calculator->calculateES(returns, confidence);
-            double esPercent = es * 100;
+            BootstrapInterval interval = calculator->bootstrapInterval(returns, confidence, options);
+            blockLength = interval.blockLength;
             
-            BacktestingResult backtest = Backtesting::performBacktest(returns, var, es, confidence);
+            std::ostringstream varRange, esRange;
+            varRange << std::fixed << std::setprecision(2) << "[" << interval.varLower * 100
+                     << ", " << interval.varUpper * 100 << "]";
+            esRange << std::fixed << std::setprecision(2) << "[" << interval.esLower * 100
+                    << ", " << interval.esUpper * 100 << "]";
             
             std::cout << std::left << std::setw(30) << calculator->getMethodName()
-                      << std::right << std::setw(15) << std::fixed << std::setprecision(2) << varPercent << "%"
-                      << std::setw(15) << std::fixed << std::setprecision(2) << esPercent << "%"
-                      << std::setw(15) << std::fixed << std::setprecision(2) << backtest.exceedanceRate*100 << "%\n";
+                      << std::right << std::setw(10) << std::fixed << std::setprecision(2) << interval.estimate.var * 100
+                      << std::setw(20) << varRange.str()
+                      << std::setw(10) << interval.estimate.es * 100
+                      << std::setw(20) << esRange.str() << "\n";
         } catch (const std::exception& e) {
             std::cout << std::left << std::setw(30) << calculator->getMethodName()
                       << std::right << std::setw(30) << "Error: " << e.what() << "\n";
         }
     }
     
-    std::cout << std::string(75, '-') << "\n";
+    std::cout << std::string(90, '-') << "\n";
+    if (options.scheme != BootstrapScheme::Iid) {
+        std::cout << (options.scheme == BootstrapScheme::Stationary ? "Stationary" : "Moving block")
+                  << " bootstrap, block length " << blockLength << "\n";
+    }
     std::cout << "\n";
 }
 
+std::vector<double> parseConfidenceLevels(const std::string& list) {
+    std::vector<double> levels;
+    std::stringstream stream(list);
+    std::string item;
+    
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            levels.push_back(std::stod(item));
+        }
+    }
+    
+    return levels;
+}
+
 void printUsage(const char* programName) {
     std::cout << "Usage: " << programName << " <csv_file> [options]\n";
     std::cout << "\nOptions:\n";
     std::cout << "  --confidence <value>    Set confidence level (default: 0.95)\n";
+    std::cout << "  --confidence-levels <l> Comma-separated levels reported together, e.g. 0.9,0.95,0.99\n";
+    std::cout << "  --write-cache <file>    Also save the loaded returns as a binary cache for later runs\n";
     std::cout << "  --column <name>         Column name for returns (default: 'returns')\n";
     std::cout << "  --price-column <name>   Column name for prices (will calculate returns)\n";
     std::cout << "  --log-returns           Use log returns instead of simple returns\n";
     std::cout << "  --simulations <n>       Number of Monte Carlo simulations (default: 10000)\n";
-    std::cout << "  --bandwidth <value>     Kernel bandwidth (default: auto)\n";
+    std::cout << "  --sampling <mode>       Monte Carlo sampling: pseudo, antithetic, sobol or importance\n";
+    std::cout << "  --seed <n>              Monte Carlo random seed (default: 42)\n";
+    std::cout << "  --threads <n>           Worker threads for CSV parsing and Monte Carlo (default: all cores)\n";
+    std::cout << "  --bandwidth <h|rule>    Kernel bandwidth, or silverman, sj (Sheather-Jones) or lscv (default: silverman)\n";
+    std::cout << "  --kde-mode <mode>       Kernel CDF engine: exact or binned (default: exact)\n";
+    std::cout << "  --backtest <window>     Walk-forward backtest: refit on a rolling window, test on the next return\n";
+    std::cout << "  --bootstrap <n>         Percentile confidence intervals of VaR and ES from n resamples\n";
+    std::cout << "  --bootstrap-scheme <s>  iid, block or stationary; block schemes keep volatility clusters (default: iid)\n";
+    std::cout << "  --block-length <n>      Mean block length of the block schemes (default: n^(1/3))\n";
+    std::cout << "  --interval-level <v>    Coverage of the bootstrap intervals (default: 0.90)\n";
+    std::cout << "  --profile [table|json]  Print time per stage, event counters and allocations\n";
+    std::cout << "\nStreaming mode (<csv_file> may be - for stdin, or a named pipe):\n";
+    std::cout << "  --stream                Emit a VaR/ES line per observation until end of input\n";
+    std::cout << "  --window <n>            Rolling window of the streaming estimators (default: 250)\n";
+    std::cout << "  --batch <n>             Observations per streamed update (default: 1)\n";
+    std::cout << "  --lambda <value>        EWMA decay of the streaming estimator (default: 0.94)\n";
     std::cout << "\nExample:\n";
     std::cout << "  " << programName << " data/returns.csv\n";
     std::cout << "  " << programName << " data/prices.csv --price-column price --log-returns\n";
     std::cout << "  " << programName << " data/returns.csv --confidence 0.99\n";
+    std::cout << "  " << programName << " data/returns.csv --confidence-levels 0.9,0.95,0.99\n";
+    std::cout << "  " << programName << " data/returns.csv --write-cache data/returns.varc\n";
+    std::cout << "  " << programName << " data/returns.varc\n";
+    std::cout << "  " << programName << " data/returns.csv --backtest 250 --confidence 0.99\n";
+    std::cout << "  " << programName << " data/returns.csv --bootstrap 2000 --bootstrap-scheme stationary\n";
+    std::cout << "  " << programName << " data/returns.csv --bandwidth sj --confidence 0.99\n";
+    std::cout << "  tail -f ticks.csv | " << programName << " - --stream --window 500\n";
+}
+
+// Rejects a value that is not one of an option's names
+int rejectOption(const char* programName, const std::string& option, const std::string& value) {
+    std::cerr << "Error: unknown value '" << value << "' for " << option << "\n";
+    printUsage(programName);
+    return 1;
 }
 
 int main(int argc, char* argv[]) {
@@ -84,17 +272,37 @@ int main(int argc, char* argv[]) {
     // Default parameters
     std::string filename = argv[1];
     double confidence = 0.95;
+    std::vector<double> confidenceLevels;
     std::string columnName = "returns";
     std::string priceColumn = "";
+    std::string cacheFile = "";
     bool logReturns = true;
     int numSimulations = 10000;
+    uint64_t seed = MonteCarloVaR::DEFAULT_SEED;
+    unsigned numThreads = 0;
+    MonteCarloVaR::SamplingMode samplingMode = MonteCarloVaR::SamplingMode::PseudoRandom;
     double bandwidth = -1.0;
+    BandwidthSelector::Rule bandwidthRule = BandwidthSelector::Rule::Silverman;
+    KdeCdf::Mode kdeMode = KdeCdf::Mode::Exact;
+    size_t backtestWindow = 0;
+    BootstrapOptions bootstrap;
+    bootstrap.resamples = 0;
+    bool streamMode = false;
+    bool profile = false;
+    Profiler::Format profileFormat = Profiler::Format::Table;
+    size_t streamWindow = 250;
+    size_t streamBatch = 1;
+    double lambda = EwmaVariance::RISKMETRICS_LAMBDA;
     
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
         
         if (arg == "--confidence" && i + 1 < argc) {
             confidence = std::stod(argv[++i]);
+        } else if (arg == "--confidence-levels" && i + 1 < argc) {
+            confidenceLevels = parseConfidenceLevels(argv[++i]);
+        } else if (arg == "--write-cache" && i + 1 < argc) {
+            cacheFile = argv[++i];
         } else if (arg == "--column" && i + 1 < argc) {
             columnName = argv[++i];
         } else if (arg == "--price-column" && i + 1 < argc) {
@@ -103,8 +311,55 @@ int main(int argc, char* argv[]) {
             logReturns = true;
         } else if (arg == "--simulations" && i + 1 < argc) {
             numSimulations = std::stoi(argv[++i]);
+        } else if (arg == "--sampling" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (!MonteCarloVaR::parseSamplingMode(mode, samplingMode)) {
+                return rejectOption(argv[0], arg, mode);
+            }
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            numThreads = static_cast<unsigned>(std::stoul(argv[++i]));
         } else if (arg == "--bandwidth" && i + 1 < argc) {
-            bandwidth = std::stod(argv[++i]);
+            std::string value = argv[++i];
+            if (!BandwidthSelector::parseRule(value, bandwidthRule)) {
+                char* end = nullptr;
+                bandwidth = std::strtod(value.c_str(), &end);
+                if (end == value.c_str() || *end != '\0') {
+                    return rejectOption(argv[0], arg, value);
+                }
+            }
+        } else if (arg == "--kde-mode" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (!KdeCdf::parseMode(mode, kdeMode)) {
+                return rejectOption(argv[0], arg, mode);
+            }
+        } else if (arg == "--backtest" && i + 1 < argc) {
+            backtestWindow = std::stoul(argv[++i]);
+        } else if (arg == "--bootstrap" && i + 1 < argc) {
+            bootstrap.resamples = std::stoul(argv[++i]);
+        } else if (arg == "--bootstrap-scheme" && i + 1 < argc) {
+            std::string scheme = argv[++i];
+            if (!parseBootstrapScheme(scheme, bootstrap.scheme)) {
+                return rejectOption(argv[0], arg, scheme);
+            }
+        } else if (arg == "--block-length" && i + 1 < argc) {
+            bootstrap.blockLength = std::stoul(argv[++i]);
+        } else if (arg == "--interval-level" && i + 1 < argc) {
+            bootstrap.level = std::stod(argv[++i]);
+        } else if (arg == "--profile") {
+            profile = true;
+            if (i + 1 < argc && (std::string(argv[i + 1]) == "json" || std::string(argv[i + 1]) == "table")) {
+                profileFormat = std::string(argv[++i]) == "json" ? Profiler::Format::Json : Profiler::Format::Table;
+            }
+        } else if (arg == "--stream") {
+            streamMode = true;
+        } else if (arg == "--window" && i + 1 < argc) {
+            streamWindow = std::stoul(argv[++i]);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            streamBatch = std::stoul(argv[++i]);
+        } else if (arg == "--lambda" && i + 1 < argc) {
+            lambda = std::stod(argv[++i]);
         } else if (arg == "--help" || arg == "-h") {
             printUsage(argv[0]);
             std::cout << "\nPress ENTER to exit...";
@@ -113,6 +368,36 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    Profiler::setEnabled(profile);
+    
+    if (streamMode) {
+        // stdout carries the updates and stdin may be the feed, so no
+        // banner and no ENTER prompt; the latency report goes to stderr
+        std::ios::sync_with_stdio(false);
+        try {
+            StreamMonitor monitor(streamWindow, confidence, lambda, streamBatch);
+            
+            if (filename == "-") {
+                monitor.run(std::cin, std::cout);
+            } else {
+                std::ifstream feed(filename);
+                if (!feed.is_open()) {
+                    throw std::runtime_error("Could not open file: " + filename);
+                }
+                monitor.run(feed, std::cout);
+            }
+            
+            monitor.writeLatencyReport(std::cerr);
+            if (profile) {
+                std::cerr << Profiler::report(profileFormat);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    
     printHeader();
     
     try {
@@ -130,7 +415,13 @@ int main(int argc, char* argv[]) {
         std::cout << "Loading data from: " << filename << "\n";
         
         std::cout << "Reading returns from column: " << columnName << "\n";
-        returns = CSVParser::parseReturns(filename, columnName);
+        if (ReturnCache::isCache(filename)) {
+            // The calculators take vectors, so the mapped column is copied once
+            ReturnCache cache(filename);
+            returns = cache.column(columnName).toVector();
+        } else {
+            returns = CSVParser::parseReturns(filename, columnName, numThreads);
+        }
 
         if (returns.empty()) {
             std::cerr << "Error: No data loaded from CSV file\n";
@@ -139,23 +430,70 @@ int main(int argc, char* argv[]) {
             return 1;
         }   
 
-        std::cout << "Successfully loaded " << returns.size() << " observations\n\n";
+        std::cout << "Successfully loaded " << returns.size() << " observations\n";
+        
+        if (!cacheFile.empty()) {
+            CSVTable table;
+            table.names.push_back(columnName);
+            table.columns.push_back(returns);
+            ReturnCache::write(cacheFile, table);
+            std::cout << "Wrote return cache: " << cacheFile << "\n";
+        }
+        std::cout << "\n";
+        
+        // Every calculator reads the same series, so its sort, moments and
+        // bandwidth are computed once for the whole report
+        ReturnSeries series(returns);
         
         std::vector<std::unique_ptr<VarCalculator>> calculators;
         calculators.push_back(std::make_unique<HistoricalVaR>());
+        calculators.push_back(std::make_unique<FilteredHistoricalVaR>());
         calculators.push_back(std::make_unique<ParametricVaR>());
+        calculators.push_back(std::make_unique<CornishFisherVaR>());
         
-        auto mcVar = std::make_unique<MonteCarloVaR>(numSimulations);
+        // A backtest parallelises over dates and a bootstrap over resamples,
+        // so each Monte Carlo run stays on one thread
+        unsigned mcThreads = (backtestWindow > 0 || bootstrap.resamples > 0) ? 1 : numThreads;
+        auto mcVar = std::make_unique<MonteCarloVaR>(numSimulations, seed, mcThreads, samplingMode);
         calculators.push_back(std::move(mcVar));
         
-        auto kernelVar = std::make_unique<KernelVaR>(bandwidth);
+        auto kernelVar = std::make_unique<KernelVaR>(bandwidth, kdeMode);
+        kernelVar->setBandwidthRule(bandwidthRule);
         calculators.push_back(std::move(kernelVar));
+        calculators.push_back(std::make_unique<EvtVaR>());
         
-        printVaRResults(calculators, returns, confidence);
+        if (backtestWindow > 0) {
+            for (const auto& calculator : calculators) {
+                std::cout << calculator->getMethodName() << ":";
+                try {
+                    WalkForwardResult backtest = Backtesting::walkForward(*calculator, returns, backtestWindow,
+                                                                          confidence, numThreads);
+                    std::cout << Backtesting::formatWalkForwardResults(backtest) << "\n";
+                } catch (const std::exception& e) {
+                    std::cout << " Error: " << e.what() << "\n\n";
+                }
+            }
+        } else if (bootstrap.resamples > 0) {
+            bootstrap.seed = seed;
+            bootstrap.numThreads = numThreads;
+            printBootstrapIntervals(calculators, series, confidence, bootstrap);
+        } else if (!confidenceLevels.empty()) {
+            printMultiLevelResults(calculators, series, confidenceLevels);
+            
+            std::cout << "Note: VaR represents the maximum loss at the given confidence level.\n";
+            std::cout << "      ES (Expected Shortfall) is the average loss beyond the VaR threshold.\n";
+        } else {
+            printVaRResults(calculators, series, confidence);
+            
+            std::cout << "Note: VaR represents the maximum loss at the given confidence level.\n";
+            std::cout << "      ES (Expected Shortfall) is the average loss beyond the VaR threshold.\n";
+            std::cout << "      A normal exceedance rate is close to " << std::fixed << std::setprecision(2)
+                      << (1.0 - confidence) * 100 << "%.\n";
+        }
         
-        std::cout << "Note: VaR represents the maximum loss at the given confidence level.\n";
-        std::cout << "      ES (Expected Shortfall) is the average loss beyond the VaR threshold.\n";
-        std::cout << "      A normal exceedance rate is close to " << confidence * 100 << "%.\n";
+        if (profile) {
+            std::cout << "\nProfile:\n" << Profiler::report(profileFormat);
+        }
         
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
@@ -1,70 +1,261 @@
 #include "monte_carlo_var.h"
-#include <random>
+#include "profiler.h"
+#include "tail_selection.h"
+#include "special_functions.h"
 #include <algorithm>
 #include <cmath>
+#include <stdexcept>
 
-MonteCarloVaR::MonteCarloVaR(int numSimulations) : numSimulations_(numSimulations) {}
+MonteCarloVaR::MonteCarloVaR(int numSimulations, uint64_t seed, unsigned numThreads, SamplingMode mode)
+    : numSimulations_(numSimulations), engine_(seed, numThreads), samplingMode_(mode) {}
 
-double MonteCarloVaR::calculateVaR(const std::vector<double>& returns, double confidence) {
+const char* MonteCarloVaR::samplingModeName(SamplingMode mode) {
+    switch (mode) {
+        case SamplingMode::Antithetic: return "antithetic";
+        case SamplingMode::Sobol: return "sobol";
+        case SamplingMode::ImportanceSampling: return "importance";
+        default: return "pseudo";
+    }
+}
+
+bool MonteCarloVaR::parseSamplingMode(const std::string& name, SamplingMode& mode) {
+    for (SamplingMode candidate : {SamplingMode::PseudoRandom, SamplingMode::Antithetic,
+                                   SamplingMode::Sobol, SamplingMode::ImportanceSampling}) {
+        if (name == samplingModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+double MonteCarloVaR::calculateVaR(const ReturnSeries& returns, double confidence) {
+    return calculateRisk(returns, confidence).var;
+}
+
+double MonteCarloVaR::calculateES(const ReturnSeries& returns, double confidence) {
+    return calculateRisk(returns, confidence).es;
+}
+
+RiskMeasures MonteCarloVaR::calculateRisk(const ReturnSeries& returns, double confidence) {
+    return calculateRiskBatch(returns, {confidence}).front();
+}
+
+std::vector<RiskMeasures> MonteCarloVaR::calculateRiskBatch(const ReturnSeries& returns,
+                                                           const std::vector<double>& confidences) {
+    VAR_PROFILE_SCOPE("montecarlo.risk");
     if (returns.empty()) {
         throw std::runtime_error("Cannot calculate VaR with empty returns");
     }
+    if (numSimulations_ <= 0) {
+        throw std::runtime_error("Number of simulations must be positive");
+    }
+    if (confidences.empty()) {
+        return {};
+    }
+    
+    const HigherMoments& moments = returns.moments();
+    double mu = moments.mean();
+    double sigma = moments.stdDev();
     
-    double mu = mean(returns);
-    double sigma = standardDeviation(returns);
+    if (samplingMode_ == SamplingMode::ImportanceSampling) {
+        return importanceSamplingRisk(mu, sigma, confidences);
+    }
     
+    // One simulation serves every measure at every level
     std::vector<double> simulatedReturns = simulateReturns(mu, sigma, numSimulations_);
     
-    std::sort(simulatedReturns.begin(), simulatedReturns.end());
-
-    double alpha = 1.0 - confidence;
-    size_t index = static_cast<size_t>(alpha * numSimulations_);
+    // Each batch is an independent replication of the sampling scheme
+    std::vector<std::vector<RiskMeasures>> batches;
+    size_t size = batchSize(simulatedReturns.size());
+    for (size_t begin = 0; begin + size <= simulatedReturns.size(); begin += size) {
+        if (samplingMode_ == SamplingMode::Sobol) {
+            // Small stratified sets need the fractional tail boundary, or
+            // rounding the tail count up biases every replicate the same way
+            std::vector<std::pair<double, double>> batch;
+            batch.reserve(size);
+            for (size_t i = begin; i < begin + size; ++i) {
+                batch.emplace_back(simulatedReturns[i], 1.0);
+            }
+            batches.push_back(weightedRisk(batch, confidences));
+        } else {
+            std::vector<double> batch(simulatedReturns.begin() + begin, simulatedReturns.begin() + begin + size);
+            batches.push_back(sampleRisk(batch, confidences));
+        }
+    }
+    
+    std::vector<RiskMeasures> risks = sampleRisk(simulatedReturns, confidences);
+    setStandardErrors(risks, batches);
     
-    if (index >= simulatedReturns.size()) {
-        index = simulatedReturns.size() - 1;
+    // Randomized QMC: the error estimate belongs to the replicate average,
+    // since the pooled quantile of stratified sets is not covered by it
+    if (samplingMode_ == SamplingMode::Sobol && batches.size() >= 2) {
+        for (size_t level = 0; level < risks.size(); ++level) {
+            risks[level].var = 0.0;
+            risks[level].es = 0.0;
+            for (const auto& batch : batches) {
+                risks[level].var += batch[level].var / batches.size();
+                risks[level].es += batch[level].es / batches.size();
+            }
+        }
     }
     
-    return -simulatedReturns[index];
+    return risks;
 }
 
 std::vector<double> MonteCarloVaR::simulateReturns(double mean, double stdDev, int n) {
-    std::vector<double> simulated;
-    simulated.reserve(n);
+    VAR_PROFILE_SCOPE("montecarlo.simulate");
+    VAR_PROFILE_COUNT("montecarlo.paths", n);
+    size_t count = static_cast<size_t>(n);
+    
+    switch (samplingMode_) {
+        case SamplingMode::Antithetic:
+            return engine_.simulateAntithetic(mean, stdDev, count);
+        case SamplingMode::Sobol:
+            return engine_.simulateSobol(mean, stdDev, count, batchSize(count));
+        default:
+            return engine_.simulateNormal(mean, stdDev, count);
+    }
+}
+
+size_t MonteCarloVaR::batchSize(size_t n) const {
+    size_t size = (n + NUM_BATCHES - 1) / NUM_BATCHES;
+    return std::max<size_t>(2, size + (size % 2));
+}
+
+std::vector<RiskMeasures> MonteCarloVaR::importanceSamplingRisk(double mean, double stdDev,
+                                                               const std::vector<double>& confidences) {
+    VAR_PROFILE_SCOPE("montecarlo.importance");
+    // Sample z ~ N(theta, 1) centred on the most extreme requested quantile
+    // and reweight by the likelihood ratio phi(z) / phi(z - theta)
+    double alpha = 1.0;
+    for (double confidence : confidences) {
+        alpha = std::min(alpha, 1.0 - confidence);
+    }
+    if (alpha <= 0.0) {
+        throw std::runtime_error("Confidence level must be less than 1.0");
+    }
     
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<double> dist(mean, stdDev);
+    double theta = SpecialFunctions::inverseNormalCdf(alpha);
+    std::vector<double> shifted = engine_.simulateNormal(theta, 1.0, static_cast<size_t>(numSimulations_));
+    VAR_PROFILE_COUNT("montecarlo.paths", shifted.size());
     
-    for (int i = 0; i < n; ++i) {
-        simulated.push_back(dist(gen));
+    std::vector<std::pair<double, double>> weighted(shifted.size());
+    for (size_t i = 0; i < shifted.size(); ++i) {
+        double z = shifted[i];
+        weighted[i] = {mean + stdDev * z, std::exp(-theta * z + 0.5 * theta * theta)};
     }
     
-    return simulated;
+    std::vector<std::vector<RiskMeasures>> batches;
+    size_t size = batchSize(weighted.size());
+    for (size_t begin = 0; begin + size <= weighted.size(); begin += size) {
+        std::vector<std::pair<double, double>> batch(weighted.begin() + begin, weighted.begin() + begin + size);
+        batches.push_back(weightedRisk(batch, confidences));
+    }
+    
+    std::vector<RiskMeasures> risks = weightedRisk(weighted, confidences);
+    setStandardErrors(risks, batches);
+    
+    return risks;
 }
 
-double MonteCarloVaR::calculateES(const std::vector<double>& returns, double confidence) {
-    if (returns.empty()) {
-        throw std::runtime_error("Cannot calculate ES with empty returns");
+std::vector<RiskMeasures> MonteCarloVaR::sampleRisk(std::vector<double>& sample,
+                                                    const std::vector<double>& confidences) {
+    // Select the widest tail once; every level reads a sorted prefix of it
+    std::vector<size_t> indices;
+    size_t tailSize = 1;
+    for (double confidence : confidences) {
+        double alpha = 1.0 - confidence;
+        size_t index = std::min(static_cast<size_t>(alpha * sample.size()), sample.size() - 1);
+        indices.push_back(index);
+        tailSize = std::max({tailSize, index + 1, TailSelection::esTailCount(sample.size(), alpha)});
     }
+    TailSelection::selectLowest(sample, tailSize);
     
-    double mu = mean(returns);
-    double sigma = standardDeviation(returns);
+    std::vector<RiskMeasures> risks;
+    risks.reserve(confidences.size());
+    for (size_t level = 0; level < confidences.size(); ++level) {
+        RiskMeasures risk = summarizeTail(sample, confidences[level]);
+        risk.var = -sample[indices[level]];
+        risks.push_back(risk);
+    }
     
-    std::vector<double> simulatedReturns = simulateReturns(mu, sigma, numSimulations_);
-    std::sort(simulatedReturns.begin(), simulatedReturns.end());
+    return risks;
+}
+
+std::vector<RiskMeasures> MonteCarloVaR::weightedRisk(std::vector<std::pair<double, double>>& sample,
+                                                      const std::vector<double>& confidences) {
+    VAR_PROFILE_SCOPE("montecarlo.weighted_sort");
+    std::sort(sample.begin(), sample.end());
     
+    std::vector<RiskMeasures> risks;
+    risks.reserve(confidences.size());
+    for (double confidence : confidences) {
+        risks.push_back(weightedTail(sample, confidence));
+    }
+    return risks;
+}
+
+RiskMeasures MonteCarloVaR::weightedTail(const std::vector<std::pair<double, double>>& sorted, double confidence) {
     double alpha = 1.0 - confidence;
     if (alpha <= 0.0) {
         throw std::runtime_error("Confidence level must be less than 1.0");
     }
     
-    size_t tailCount = static_cast<size_t>(std::ceil(alpha * simulatedReturns.size()));
-    tailCount = std::max<size_t>(1, tailCount);
+    // Walk up the weighted empirical CDF until it reaches alpha; the
+    // boundary path only contributes the weight still missing
+    double target = alpha * sorted.size();
+    double cumulative = 0.0;
+    double sumX = 0.0;
+    double sumX2 = 0.0;
+    size_t j = 0;
+    
+    for (; j < sorted.size(); ++j) {
+        double x = sorted[j].first;
+        double w = std::min(sorted[j].second, target - cumulative);
+        cumulative += w;
+        sumX += w * x;
+        sumX2 += w * x * x;
+        if (cumulative >= target) {
+            break;
+        }
+    }
+    j = std::min(j, sorted.size() - 1);
+    
+    double tailMean = sumX / cumulative;
+    
+    RiskMeasures risk;
+    risk.var = -sorted[j].first;
+    risk.es = -tailMean;
+    risk.tailCount = j + 1;
+    risk.worstLoss = -sorted.front().first;
+    risk.tailStdDev = std::sqrt(std::max(0.0, sumX2 / cumulative - tailMean * tailMean));
     
-    double sum = 0.0;
-    for (size_t i = 0; i < tailCount; ++i) {
-        sum += simulatedReturns[i];
+    return risk;
+}
+
+void MonteCarloVaR::setStandardErrors(std::vector<RiskMeasures>& risks,
+                                      const std::vector<std::vector<RiskMeasures>>& batches) {
+    size_t b = batches.size();
+    if (b < 2) {
+        return;
     }
     
-    return -(sum / static_cast<double>(tailCount));
+    for (size_t level = 0; level < risks.size(); ++level) {
+        double varMean = 0.0, esMean = 0.0;
+        for (const auto& batch : batches) {
+            varMean += batch[level].var / b;
+            esMean += batch[level].es / b;
+        }
+        
+        double varSS = 0.0, esSS = 0.0;
+        for (const auto& batch : batches) {
+            varSS += (batch[level].var - varMean) * (batch[level].var - varMean);
+            esSS += (batch[level].es - esMean) * (batch[level].es - esMean);
+        }
+        
+        // Standard error of the mean of b replications
+        risks[level].varStandardError = std::sqrt(varSS / (b - 1) / b);
+        risks[level].esStandardError = std::sqrt(esSS / (b - 1) / b);
+    }
 }
@@ -0,0 +1,252 @@
+#include "normal_generator.h"
+#include "cpu_features.h"
+#include "simd_math.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double TWO_PI = 6.28318530717958647692;
+
+// Box-Muller pairs are produced CHUNK at a time: the cosine halves go to
+// out[0, m) and the sine halves to out[m, 2m)
+const size_t CHUNK = 256;
+
+void boxMullerScalar(const double* u1, const double* u2, double* cosOut, double* sinOut,
+                     size_t m, double mean, double stdDev) {
+    for (size_t i = 0; i < m; ++i) {
+        double radius = stdDev * std::sqrt(-2.0 * std::log(u1[i]));
+        double theta = TWO_PI * u2[i];
+        cosOut[i] = mean + radius * std::cos(theta);
+        sinOut[i] = mean + radius * std::sin(theta);
+    }
+}
+
+void uniformsScalar(Philox4x32& gen, double* u1, double* u2, size_t m) {
+    for (size_t i = 0; i < m; ++i) {
+        u1[i] = 1.0 - gen.uniform();  // (0, 1] keeps the log finite
+        u2[i] = gen.uniform();
+    }
+}
+
+#if VAR_X86_SIMD
+
+// The SIMD Philox kernels evaluate one block per 64-bit lane and reproduce
+// exactly what Philox4x32::uniform() would return: block i of the chunk
+// yields u1[i] from words 0-1 and u2[i] from words 2-3.
+
+VAR_TARGET_AVX2 __m256d wordsToUniform256(__m256i hi, __m256i lo) {
+    // (hi * 2^32 + lo) >> 11 scaled by 2^-53, split into two exact terms
+    const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+    const __m256d twoTo52 = _mm256_set1_pd(4503599627370496.0);
+    __m256d hiD = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(hi, magic)), twoTo52);
+    __m256d loD = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(lo, 11), magic)), twoTo52);
+    return _mm256_fmadd_pd(hiD, _mm256_set1_pd(0x1.0p-32), _mm256_mul_pd(loD, _mm256_set1_pd(0x1.0p-53)));
+}
+
+VAR_TARGET_AVX2 void uniformsAvx2(Philox4x32& gen, double* u1, double* u2, size_t m) {
+    const __m256i low32 = _mm256_set1_epi64x(0xFFFFFFFFLL);
+    const __m256i mul0 = _mm256_set1_epi64x(Philox4x32::M0);
+    const __m256i mul1 = _mm256_set1_epi64x(Philox4x32::M1);
+    const __m256d one = _mm256_set1_pd(1.0);
+    
+    uint64_t position = gen.blockPosition();
+    uint64_t stream = gen.stream();
+    __m256i c2Init = _mm256_set1_epi64x(static_cast<uint32_t>(stream));
+    __m256i c3Init = _mm256_set1_epi64x(static_cast<uint32_t>(stream >> 32));
+    
+    __m256i roundKey0[Philox4x32::ROUNDS];
+    __m256i roundKey1[Philox4x32::ROUNDS];
+    uint32_t k0 = gen.key(0);
+    uint32_t k1 = gen.key(1);
+    for (int r = 0; r < Philox4x32::ROUNDS; ++r) {
+        roundKey0[r] = _mm256_set1_epi64x(k0);
+        roundKey1[r] = _mm256_set1_epi64x(k1);
+        k0 += Philox4x32::W0;
+        k1 += Philox4x32::W1;
+    }
+    
+    size_t i = 0;
+    for (; i + 4 <= m; i += 4) {
+        uint64_t p = position + i;
+        __m256i counter = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(p)),
+                                           _mm256_set_epi64x(3, 2, 1, 0));
+        __m256i c0 = _mm256_and_si256(counter, low32);
+        __m256i c1 = _mm256_srli_epi64(counter, 32);
+        __m256i c2 = c2Init;
+        __m256i c3 = c3Init;
+        
+        for (int r = 0; r < Philox4x32::ROUNDS; ++r) {
+            __m256i p0 = _mm256_mul_epu32(mul0, c0);
+            __m256i p1 = _mm256_mul_epu32(mul1, c2);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), roundKey0[r]);
+            c1 = _mm256_and_si256(p1, low32);
+            c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), roundKey1[r]);
+            c3 = _mm256_and_si256(p0, low32);
+        }
+        
+        _mm256_storeu_pd(u1 + i, _mm256_sub_pd(one, wordsToUniform256(c0, c1)));
+        _mm256_storeu_pd(u2 + i, wordsToUniform256(c2, c3));
+    }
+    
+    gen.discardBlocks(i);
+    uniformsScalar(gen, u1 + i, u2 + i, m - i);
+}
+
+VAR_TARGET_AVX512 __m512d wordsToUniform512(__m512i hi, __m512i lo) {
+    const __m512i magic = _mm512_set1_epi64(0x4330000000000000LL);
+    const __m512d twoTo52 = _mm512_set1_pd(4503599627370496.0);
+    __m512d hiD = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(hi, magic)), twoTo52);
+    __m512d loD = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(_mm512_srli_epi64(lo, 11), magic)), twoTo52);
+    return _mm512_fmadd_pd(hiD, _mm512_set1_pd(0x1.0p-32), _mm512_mul_pd(loD, _mm512_set1_pd(0x1.0p-53)));
+}
+
+VAR_TARGET_AVX512 void uniformsAvx512(Philox4x32& gen, double* u1, double* u2, size_t m) {
+    const __m512i low32 = _mm512_set1_epi64(0xFFFFFFFFLL);
+    const __m512i mul0 = _mm512_set1_epi64(Philox4x32::M0);
+    const __m512i mul1 = _mm512_set1_epi64(Philox4x32::M1);
+    const __m512d one = _mm512_set1_pd(1.0);
+    
+    uint64_t position = gen.blockPosition();
+    uint64_t stream = gen.stream();
+    __m512i c2Init = _mm512_set1_epi64(static_cast<uint32_t>(stream));
+    __m512i c3Init = _mm512_set1_epi64(static_cast<uint32_t>(stream >> 32));
+    
+    __m512i roundKey0[Philox4x32::ROUNDS];
+    __m512i roundKey1[Philox4x32::ROUNDS];
+    uint32_t k0 = gen.key(0);
+    uint32_t k1 = gen.key(1);
+    for (int r = 0; r < Philox4x32::ROUNDS; ++r) {
+        roundKey0[r] = _mm512_set1_epi64(k0);
+        roundKey1[r] = _mm512_set1_epi64(k1);
+        k0 += Philox4x32::W0;
+        k1 += Philox4x32::W1;
+    }
+    
+    size_t i = 0;
+    for (; i + 8 <= m; i += 8) {
+        uint64_t p = position + i;
+        __m512i counter = _mm512_add_epi64(_mm512_set1_epi64(static_cast<long long>(p)),
+                                           _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0));
+        __m512i c0 = _mm512_and_si512(counter, low32);
+        __m512i c1 = _mm512_srli_epi64(counter, 32);
+        __m512i c2 = c2Init;
+        __m512i c3 = c3Init;
+        
+        for (int r = 0; r < Philox4x32::ROUNDS; ++r) {
+            __m512i p0 = _mm512_mul_epu32(mul0, c0);
+            __m512i p1 = _mm512_mul_epu32(mul1, c2);
+            c0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p1, 32), c1), roundKey0[r]);
+            c1 = _mm512_and_si512(p1, low32);
+            c2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p0, 32), c3), roundKey1[r]);
+            c3 = _mm512_and_si512(p0, low32);
+        }
+        
+        _mm512_storeu_pd(u1 + i, _mm512_sub_pd(one, wordsToUniform512(c0, c1)));
+        _mm512_storeu_pd(u2 + i, wordsToUniform512(c2, c3));
+    }
+    
+    gen.discardBlocks(i);
+    uniformsScalar(gen, u1 + i, u2 + i, m - i);
+}
+
+VAR_TARGET_AVX2 void boxMullerAvx2(const double* u1, const double* u2, double* cosOut, double* sinOut,
+                                   size_t m, double mean, double stdDev) {
+    const __m256d minusTwo = _mm256_set1_pd(-2.0);
+    const __m256d mu = _mm256_set1_pd(mean);
+    const __m256d sigma = _mm256_set1_pd(stdDev);
+    
+    size_t i = 0;
+    for (; i + 4 <= m; i += 4) {
+        __m256d radius = _mm256_mul_pd(sigma, _mm256_sqrt_pd(
+            _mm256_mul_pd(minusTwo, simd::log256(_mm256_loadu_pd(u1 + i)))));
+        __m256d s, c;
+        simd::sinCos2Pi256(_mm256_loadu_pd(u2 + i), s, c);
+        _mm256_storeu_pd(cosOut + i, _mm256_fmadd_pd(radius, c, mu));
+        _mm256_storeu_pd(sinOut + i, _mm256_fmadd_pd(radius, s, mu));
+    }
+    boxMullerScalar(u1 + i, u2 + i, cosOut + i, sinOut + i, m - i, mean, stdDev);
+}
+
+VAR_TARGET_AVX512 void boxMullerAvx512(const double* u1, const double* u2, double* cosOut, double* sinOut,
+                                       size_t m, double mean, double stdDev) {
+    const __m512d minusTwo = _mm512_set1_pd(-2.0);
+    const __m512d mu = _mm512_set1_pd(mean);
+    const __m512d sigma = _mm512_set1_pd(stdDev);
+    
+    size_t i = 0;
+    for (; i + 8 <= m; i += 8) {
+        __m512d radius = _mm512_mul_pd(sigma, _mm512_sqrt_pd(
+            _mm512_mul_pd(minusTwo, simd::log512(_mm512_loadu_pd(u1 + i)))));
+        __m512d s, c;
+        simd::sinCos2Pi512(_mm512_loadu_pd(u2 + i), s, c);
+        _mm512_storeu_pd(cosOut + i, _mm512_fmadd_pd(radius, c, mu));
+        _mm512_storeu_pd(sinOut + i, _mm512_fmadd_pd(radius, s, mu));
+    }
+    boxMullerScalar(u1 + i, u2 + i, cosOut + i, sinOut + i, m - i, mean, stdDev);
+}
+
+#endif // VAR_X86_SIMD
+
+} // namespace
+
+NormalGenerator::Backend NormalGenerator::detectBackend() {
+    if (CpuFeatures::hasAvx512()) return Backend::Avx512;
+    if (CpuFeatures::hasAvx2()) return Backend::Avx2;
+    return Backend::Scalar;
+}
+
+const char* NormalGenerator::backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Avx512: return "avx512";
+        case Backend::Avx2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+NormalGenerator::NormalGenerator(Backend backend) : backend_(backend) {
+    // Never run a kernel the CPU cannot execute
+    if (backend_ == Backend::Avx512 && !CpuFeatures::hasAvx512()) backend_ = Backend::Scalar;
+    if (backend_ == Backend::Avx2 && !CpuFeatures::hasAvx2()) backend_ = Backend::Scalar;
+}
+
+void NormalGenerator::fill(Philox4x32& gen, double* out, size_t n, double mean, double stdDev) const {
+    double u1[CHUNK];
+    double u2[CHUNK];
+    double buffer[2 * CHUNK];
+    
+    for (size_t done = 0; done < n;) {
+        size_t remaining = n - done;
+        size_t m = std::min(CHUNK, (remaining + 1) / 2);
+        
+        // Vector Philox kernels only run from a block boundary
+        bool aligned = gen.atBlockBoundary();
+        
+        // Write straight to the output unless the last pair would overrun it
+        bool direct = 2 * m <= remaining;
+        double* target = direct ? out + done : buffer;
+        
+        switch (backend_) {
+#if VAR_X86_SIMD
+            case Backend::Avx512:
+                if (aligned) uniformsAvx512(gen, u1, u2, m); else uniformsScalar(gen, u1, u2, m);
+                boxMullerAvx512(u1, u2, target, target + m, m, mean, stdDev);
+                break;
+            case Backend::Avx2:
+                if (aligned) uniformsAvx2(gen, u1, u2, m); else uniformsScalar(gen, u1, u2, m);
+                boxMullerAvx2(u1, u2, target, target + m, m, mean, stdDev);
+                break;
+#endif
+            default:
+                uniformsScalar(gen, u1, u2, m);
+                boxMullerScalar(u1, u2, target, target + m, m, mean, stdDev);
+                break;
+        }
+        
+        size_t produced = std::min(2 * m, remaining);
+        if (!direct) {
+            std::copy(buffer, buffer + produced, out + done);
+        }
+        done += produced;
+    }
+}
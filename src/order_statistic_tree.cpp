@@ -0,0 +1,170 @@
+#include "order_statistic_tree.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+void OrderStatisticTree::insert(double value) {
+    if (std::isnan(value)) {
+        throw std::runtime_error("Cannot order NaN in an order-statistic tree");
+    }
+    root_ = insert(root_, value);
+}
+
+bool OrderStatisticTree::erase(double value) {
+    bool removed = false;
+    root_ = erase(root_, value, removed);
+    return removed;
+}
+
+void OrderStatisticTree::clear() {
+    nodes_.clear();
+    freeNodes_.clear();
+    root_ = -1;
+}
+
+double OrderStatisticTree::kth(size_t k) const {
+    if (k >= size()) {
+        throw std::runtime_error("Order statistic index out of range");
+    }
+    
+    int t = root_;
+    while (true) {
+        const Node& node = nodes_[t];
+        size_t leftSize = subtreeSize(node.left);
+        if (k < leftSize) {
+            t = node.left;
+        } else if (k < leftSize + node.count) {
+            return node.key;
+        } else {
+            k -= leftSize + node.count;
+            t = node.right;
+        }
+    }
+}
+
+double OrderStatisticTree::sumSmallest(size_t k) const {
+    if (k > size()) {
+        throw std::runtime_error("Order statistic count out of range");
+    }
+    
+    double total = 0.0;
+    int t = root_;
+    while (k > 0) {
+        const Node& node = nodes_[t];
+        size_t leftSize = subtreeSize(node.left);
+        if (k <= leftSize) {
+            t = node.left;
+            continue;
+        }
+        
+        total += subtreeSum(node.left);
+        k -= leftSize;
+        size_t take = std::min<size_t>(k, node.count);
+        total += take * node.key;
+        k -= take;
+        t = node.right;
+    }
+    return total;
+}
+
+int OrderStatisticTree::newNode(double value) {
+    // xorshift32 priorities keep the treap balanced in expectation
+    rngState_ ^= rngState_ << 13;
+    rngState_ ^= rngState_ >> 17;
+    rngState_ ^= rngState_ << 5;
+    
+    Node node{value, value, 1, 1, rngState_, -1, -1};
+    if (!freeNodes_.empty()) {
+        int index = freeNodes_.back();
+        freeNodes_.pop_back();
+        nodes_[index] = node;
+        return index;
+    }
+    nodes_.push_back(node);
+    return static_cast<int>(nodes_.size() - 1);
+}
+
+void OrderStatisticTree::update(int t) {
+    Node& node = nodes_[t];
+    node.size = subtreeSize(node.left) + node.count + subtreeSize(node.right);
+    node.sum = subtreeSum(node.left) + node.count * node.key + subtreeSum(node.right);
+}
+
+int OrderStatisticTree::rotateLeft(int t) {
+    int r = nodes_[t].right;
+    nodes_[t].right = nodes_[r].left;
+    nodes_[r].left = t;
+    update(t);
+    update(r);
+    return r;
+}
+
+int OrderStatisticTree::rotateRight(int t) {
+    int l = nodes_[t].left;
+    nodes_[t].left = nodes_[l].right;
+    nodes_[l].right = t;
+    update(t);
+    update(l);
+    return l;
+}
+
+int OrderStatisticTree::insert(int t, double value) {
+    if (t < 0) {
+        return newNode(value);
+    }
+    
+    if (value == nodes_[t].key) {
+        nodes_[t].count++;
+    } else if (value < nodes_[t].key) {
+        int child = insert(nodes_[t].left, value);
+        nodes_[t].left = child;
+        if (nodes_[child].priority > nodes_[t].priority) {
+            return rotateRight(t);
+        }
+    } else {
+        int child = insert(nodes_[t].right, value);
+        nodes_[t].right = child;
+        if (nodes_[child].priority > nodes_[t].priority) {
+            return rotateLeft(t);
+        }
+    }
+    
+    update(t);
+    return t;
+}
+
+int OrderStatisticTree::erase(int t, double value, bool& removed) {
+    if (t < 0) {
+        return t;
+    }
+    
+    if (value < nodes_[t].key) {
+        nodes_[t].left = erase(nodes_[t].left, value, removed);
+    } else if (value > nodes_[t].key) {
+        nodes_[t].right = erase(nodes_[t].right, value, removed);
+    } else if (nodes_[t].count > 1) {
+        nodes_[t].count--;
+        removed = true;
+    } else {
+        int left = nodes_[t].left;
+        int right = nodes_[t].right;
+        
+        if (left < 0 || right < 0) {
+            removed = true;
+            freeNodes_.push_back(t);
+            return left < 0 ? right : left;
+        }
+        
+        // Rotate the node down towards a leaf, keeping the heap order
+        if (nodes_[left].priority > nodes_[right].priority) {
+            t = rotateRight(t);
+            nodes_[t].right = erase(nodes_[t].right, value, removed);
+        } else {
+            t = rotateLeft(t);
+            nodes_[t].left = erase(nodes_[t].left, value, removed);
+        }
+    }
+    
+    update(t);
+    return t;
+}
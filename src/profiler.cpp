@@ -0,0 +1,228 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+struct Slot {
+    const char* name;
+    bool stage;
+};
+
+// Per-slot totals of one thread. Only the owning thread adds to them, so
+// the relaxed load-and-store needs no read-modify-write; report() may read
+// them concurrently. For a stage, events counts calls and nanos the time;
+// for a counter, events is the value and nanos counts the updates.
+struct Totals {
+    std::atomic<uint64_t> events[Profiler::MAX_SLOTS] = {};
+    std::atomic<uint64_t> nanos[Profiler::MAX_SLOTS] = {};
+};
+
+void bump(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct ThreadTotals;
+
+// Slots keep registration order, which follows the pipeline. Threads that
+// have exited leave their totals in retired. reset() never writes to a
+// thread's table; it records the totals at that point as a baseline that
+// report() subtracts.
+struct Registry {
+    std::mutex mutex;
+    std::vector<Slot> slots;
+    std::vector<ThreadTotals*> threads;
+    Totals retired;
+    uint64_t baselineEvents[Profiler::MAX_SLOTS] = {};
+    uint64_t baselineNanos[Profiler::MAX_SLOTS] = {};
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+struct ThreadTotals : Totals {
+    ThreadTotals() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.threads.push_back(this);
+    }
+
+    ~ThreadTotals() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (size_t i = 0; i < r.slots.size(); ++i) {
+            bump(r.retired.events[i], events[i].load(std::memory_order_relaxed));
+            bump(r.retired.nanos[i], nanos[i].load(std::memory_order_relaxed));
+        }
+        r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+    }
+};
+
+// Totals of a slot since the process started, with the registry locked
+void lifetimeTotals(const Registry& r, size_t slot, uint64_t& events, uint64_t& nanos) {
+    events = r.retired.events[slot].load(std::memory_order_relaxed);
+    nanos = r.retired.nanos[slot].load(std::memory_order_relaxed);
+    for (const Totals* totals : r.threads) {
+        events += totals->events[slot].load(std::memory_order_relaxed);
+        nanos += totals->nanos[slot].load(std::memory_order_relaxed);
+    }
+}
+
+ThreadTotals& local() {
+    thread_local ThreadTotals totals;
+    return totals;
+}
+
+size_t registerSlot(const char* name, bool stage) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t i = 0; i < r.slots.size(); ++i) {
+        if (r.slots[i].stage == stage && (r.slots[i].name == name || std::strcmp(r.slots[i].name, name) == 0)) {
+            return i;
+        }
+    }
+    if (r.slots.size() == Profiler::MAX_SLOTS) {
+        throw std::length_error("Too many profiler stages and counters");
+    }
+    r.slots.push_back(Slot{name, stage});
+    return r.slots.size() - 1;
+}
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocationBytes{0};
+
+} // namespace
+
+void Profiler::setEnabled(bool on) {
+    enabled_.store(on, std::memory_order_relaxed);
+    if (on) {
+        setAllocationTracking(true);
+    }
+}
+
+void Profiler::setAllocationTracking(bool on) {
+    trackAllocations_.store(on, std::memory_order_relaxed);
+}
+
+void Profiler::reset() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t i = 0; i < r.slots.size(); ++i) {
+        lifetimeTotals(r, i, r.baselineEvents[i], r.baselineNanos[i]);
+    }
+    allocations = 0;
+    allocationBytes = 0;
+}
+
+size_t Profiler::stageSlot(const char* stage) {
+    return registerSlot(stage, true);
+}
+
+size_t Profiler::counterSlot(const char* counter) {
+    return registerSlot(counter, false);
+}
+
+void Profiler::addTime(size_t slot, double seconds) {
+    ThreadTotals& totals = local();
+    bump(totals.events[slot], 1);
+    bump(totals.nanos[slot], static_cast<uint64_t>(seconds * 1e9));
+}
+
+void Profiler::addCount(size_t slot, uint64_t n) {
+    ThreadTotals& totals = local();
+    bump(totals.events[slot], n);
+    bump(totals.nanos[slot], 1);
+}
+
+uint64_t Profiler::allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t Profiler::allocatedBytes() {
+    return allocationBytes.load(std::memory_order_relaxed);
+}
+
+void Profiler::recordAllocation(size_t bytes) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+std::string Profiler::report(Format format) {
+    struct Stage {
+        const char* name;
+        uint64_t calls;
+        double seconds;
+    };
+    struct Counter {
+        const char* name;
+        uint64_t value;
+    };
+
+    // Merge the thread tables; slots that saw no update since the last
+    // reset are left out
+    std::vector<Stage> stages;
+    std::vector<Counter> counters;
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (size_t i = 0; i < r.slots.size(); ++i) {
+            uint64_t events, nanos;
+            lifetimeTotals(r, i, events, nanos);
+            events -= r.baselineEvents[i];
+            nanos -= r.baselineNanos[i];
+            if (r.slots[i].stage && events > 0) {
+                stages.push_back(Stage{r.slots[i].name, events, nanos * 1e-9});
+            } else if (!r.slots[i].stage && nanos > 0) {
+                counters.push_back(Counter{r.slots[i].name, events});
+            }
+        }
+    }
+
+    std::ostringstream oss;
+
+    if (format == Format::Json) {
+        oss << std::fixed << std::setprecision(3) << "{\"stages\":[";
+        for (size_t i = 0; i < stages.size(); ++i) {
+            const Stage& stage = stages[i];
+            oss << (i ? "," : "") << "{\"name\":\"" << stage.name << "\",\"calls\":" << stage.calls
+                << ",\"total_ms\":" << stage.seconds * 1e3 << "}";
+        }
+        oss << "],\"counters\":{";
+        for (size_t i = 0; i < counters.size(); ++i) {
+            oss << (i ? "," : "") << "\"" << counters[i].name << "\":" << counters[i].value;
+        }
+        oss << "},\"allocations\":" << allocationCount() << ",\"allocated_bytes\":" << allocatedBytes() << "}\n";
+        return oss.str();
+    }
+
+    oss << std::string(75, '-') << "\n";
+    oss << std::left << std::setw(35) << "Stage"
+        << std::right << std::setw(10) << "Calls"
+        << std::setw(15) << "Total (ms)"
+        << std::setw(15) << "Mean (us)" << "\n";
+    oss << std::string(75, '-') << "\n";
+    for (const auto& stage : stages) {
+        oss << std::left << std::setw(35) << stage.name
+            << std::right << std::setw(10) << stage.calls
+            << std::setw(15) << std::fixed << std::setprecision(3) << stage.seconds * 1e3
+            << std::setw(15) << std::fixed << std::setprecision(1) << stage.seconds * 1e6 / stage.calls << "\n";
+    }
+    oss << std::string(75, '-') << "\n";
+    oss << std::left << std::setw(35) << "Counter" << std::right << std::setw(40) << "Value" << "\n";
+    oss << std::string(75, '-') << "\n";
+    for (const auto& counter : counters) {
+        oss << std::left << std::setw(35) << counter.name << std::right << std::setw(40) << counter.value << "\n";
+    }
+    oss << std::left << std::setw(35) << "allocations" << std::right << std::setw(40) << allocationCount() << "\n";
+    oss << std::left << std::setw(35) << "allocated bytes" << std::right << std::setw(40) << allocatedBytes() << "\n";
+    oss << std::string(75, '-') << "\n";
+
+    return oss.str();
+}
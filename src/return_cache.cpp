@@ -0,0 +1,158 @@
+#include "return_cache.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+const uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;     // Written as BYTE_ORDER_MARK; rejects foreign-endian files
+    uint64_t numColumns;
+};
+
+struct DirectoryEntry {
+    char name[ReturnCache::NAME_LENGTH];
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t offset;        // From the start of the file, a multiple of ALIGNMENT
+    uint64_t count;
+};
+
+size_t elementSize(ReturnCache::ColumnType type) {
+    return type == ReturnCache::ColumnType::Double ? sizeof(double) : sizeof(float);
+}
+
+size_t alignUp(size_t offset) {
+    return (offset + ReturnCache::ALIGNMENT - 1) / ReturnCache::ALIGNMENT * ReturnCache::ALIGNMENT;
+}
+
+} // namespace
+
+std::vector<double> ReturnCache::ColumnView::toVector() const {
+    if (const double* values = doubles()) {
+        return std::vector<double>(values, values + size);
+    }
+    const float* values = static_cast<const float*>(data);
+    return std::vector<double>(values, values + size);
+}
+
+ReturnCache::ReturnCache(const std::string& filename) : file_(std::make_unique<MappedFile>(filename)) {
+    VAR_PROFILE_SCOPE("cache.open");
+    std::string_view bytes = file_->view();
+
+    FileHeader header;
+    if (bytes.size() < sizeof(header)) {
+        throw std::runtime_error("Not a return cache: " + filename);
+    }
+    std::memcpy(&header, bytes.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("Not a return cache: " + filename);
+    }
+    if (header.version != VERSION) {
+        throw std::runtime_error("Unsupported return cache version in " + filename);
+    }
+    if (header.byteOrder != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Return cache was written with a different byte order: " + filename);
+    }
+    if (header.numColumns > (bytes.size() - sizeof(header)) / sizeof(DirectoryEntry)) {
+        throw std::runtime_error("Truncated return cache: " + filename);
+    }
+
+    for (uint64_t c = 0; c < header.numColumns; ++c) {
+        DirectoryEntry entry;
+        std::memcpy(&entry, bytes.data() + sizeof(header) + c * sizeof(entry), sizeof(entry));
+
+        ColumnView view;
+        view.type = static_cast<ColumnType>(entry.type);
+        view.size = static_cast<size_t>(entry.count);
+        if (entry.type > static_cast<uint32_t>(ColumnType::Float) || entry.offset % ALIGNMENT != 0
+            || entry.offset > bytes.size() || entry.count > (bytes.size() - entry.offset) / elementSize(view.type)) {
+            throw std::runtime_error("Corrupt return cache directory: " + filename);
+        }
+        view.data = bytes.data() + entry.offset;
+
+        names_.emplace_back(entry.name, strnlen(entry.name, NAME_LENGTH));
+        columns_.push_back(view);
+    }
+}
+
+bool ReturnCache::hasColumn(const std::string& name) const {
+    return std::find(names_.begin(), names_.end(), name) != names_.end();
+}
+
+ReturnCache::ColumnView ReturnCache::column(const std::string& name) const {
+    auto it = std::find(names_.begin(), names_.end(), name);
+    if (it == names_.end()) {
+        throw std::runtime_error("Column '" + name + "' not found in return cache");
+    }
+    return columns_[it - names_.begin()];
+}
+
+void ReturnCache::write(const std::string& filename, const CSVTable& table, ColumnType type) {
+    FileHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.numColumns = table.columns.size();
+
+    // Lay the arrays out after the directory, each on an aligned boundary
+    std::vector<DirectoryEntry> directory(table.columns.size());
+    size_t offset = sizeof(header) + directory.size() * sizeof(DirectoryEntry);
+    for (size_t c = 0; c < table.columns.size(); ++c) {
+        if (table.names[c].size() >= NAME_LENGTH) {
+            throw std::runtime_error("Column name too long for return cache: " + table.names[c]);
+        }
+        DirectoryEntry& entry = directory[c];
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.name, table.names[c].data(), table.names[c].size());
+        entry.type = static_cast<uint32_t>(type);
+        entry.offset = alignUp(offset);
+        entry.count = table.columns[c].size();
+        offset = entry.offset + entry.count * elementSize(type);
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(DirectoryEntry));
+
+    size_t position = sizeof(header) + directory.size() * sizeof(DirectoryEntry);
+    const char padding[ALIGNMENT] = {};
+    for (size_t c = 0; c < table.columns.size(); ++c) {
+        file.write(padding, directory[c].offset - position);
+
+        const std::vector<double>& values = table.columns[c];
+        if (type == ColumnType::Double) {
+            file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+        } else {
+            std::vector<float> narrowed(values.begin(), values.end());
+            file.write(reinterpret_cast<const char*>(narrowed.data()), narrowed.size() * sizeof(float));
+        }
+        position = directory[c].offset + directory[c].count * elementSize(type);
+    }
+
+    if (!file) {
+        throw std::runtime_error("Could not write return cache: " + filename);
+    }
+}
+
+void ReturnCache::convert(const std::string& csvFile, const std::string& cacheFile,
+                          const std::vector<std::string>& columns, ColumnType type, unsigned numThreads) {
+    write(cacheFile, CSVParser::parseColumns(csvFile, columns, numThreads), type);
+}
+
+bool ReturnCache::isCache(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
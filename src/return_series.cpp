@@ -0,0 +1,53 @@
+#include "return_series.h"
+#include "bandwidth_selector.h"
+#include "profiler.h"
+#include "tail_selection.h"
+#include <algorithm>
+#include <cmath>
+
+const std::vector<double>& ReturnSeries::sorted() const {
+    std::lock_guard<std::mutex> lock(orderMutex_);
+    if (!sorted_) {
+        VAR_PROFILE_SCOPE("series.sort");
+        auto values = std::make_shared<std::vector<double>>(*values_);
+        std::sort(values->begin(), values->end());
+        sorted_ = values;
+        tail_ = sorted_;
+        tailSize_ = sorted_->size();
+    }
+    return *sorted_;
+}
+
+std::shared_ptr<const std::vector<double>> ReturnSeries::lowest(size_t k) const {
+    std::lock_guard<std::mutex> lock(orderMutex_);
+    if (!tail_ || tailSize_ < k) {
+        tail_ = std::make_shared<const std::vector<double>>(TailSelection::lowestCopy(*values_, k));
+        tailSize_ = k;
+    }
+    return tail_;
+}
+
+const HigherMoments& ReturnSeries::moments() const {
+    std::call_once(momentsOnce_, [this]() {
+        moments_ = HigherMoments::of(*values_);
+    });
+    return moments_;
+}
+
+double ReturnSeries::silvermanBandwidth() const {
+    return 1.06 * moments().stdDev() * std::pow(static_cast<double>(size()), -0.2);
+}
+
+double ReturnSeries::sheatherJonesBandwidth() const {
+    std::call_once(sheatherJonesOnce_, [this]() {
+        sheatherJones_ = BandwidthSelector::sheatherJones(*this);
+    });
+    return sheatherJones_;
+}
+
+double ReturnSeries::lscvBandwidth() const {
+    std::call_once(lscvOnce_, [this]() {
+        lscv_ = BandwidthSelector::leastSquaresCv(*this);
+    });
+    return lscv_;
+}
@@ -0,0 +1,86 @@
+#include "rolling_historical_var.h"
+#include "historical_var.h"
+#include "tail_selection.h"
+#include <cmath>
+#include <stdexcept>
+
+RollingHistoricalVaR::RollingHistoricalVaR(size_t window, double confidence)
+    : window_(window), confidence_(confidence) {
+    if (window_ == 0) {
+        throw std::runtime_error("Rolling window must hold at least one observation");
+    }
+    if (confidence_ >= 1.0) {
+        throw std::runtime_error("Confidence level must be less than 1.0");
+    }
+    ring_.reserve(window_);
+}
+
+void RollingHistoricalVaR::push(double value) {
+    if (!std::isfinite(value)) {
+        throw std::runtime_error("Rolling window returns must be finite");
+    }
+    
+    if (ring_.size() < window_) {
+        ring_.push_back(value);
+    } else {
+        tree_.erase(ring_[oldest_]);
+        ring_[oldest_] = value;
+        oldest_ = (oldest_ + 1) % window_;
+    }
+    tree_.insert(value);
+}
+
+void RollingHistoricalVaR::reset() {
+    ring_.clear();
+    oldest_ = 0;
+    tree_.clear();
+}
+
+double RollingHistoricalVaR::var() const {
+    if (tree_.empty()) {
+        throw std::runtime_error("Cannot calculate VaR with empty returns");
+    }
+    
+    double index = HistoricalVaR::quantilePosition(tree_.size(), confidence_);
+    size_t lower = static_cast<size_t>(std::floor(index));
+    size_t upper = static_cast<size_t>(std::ceil(index));
+    
+    if (lower == upper) {
+        return -tree_.kth(lower);
+    }
+    
+    double weight = index - lower;
+    return -(tree_.kth(lower) * (1.0 - weight) + tree_.kth(upper) * weight);
+}
+
+double RollingHistoricalVaR::es() const {
+    if (tree_.empty()) {
+        throw std::runtime_error("Cannot calculate ES with empty returns");
+    }
+    
+    size_t tailCount = TailSelection::esTailCount(tree_.size(), 1.0 - confidence_);
+    return -tree_.sumSmallest(tailCount) / static_cast<double>(tailCount);
+}
+
+RollingRiskSeries RollingHistoricalVaR::compute(const std::vector<double>& returns, size_t window, double confidence) {
+    RollingRiskSeries series;
+    series.window = window;
+    if (returns.size() < window) {
+        return series;
+    }
+    
+    size_t count = returns.size() - window + 1;
+    series.var.reserve(count);
+    series.es.reserve(count);
+    
+    RollingHistoricalVaR rolling(window, confidence);
+    for (double value : returns) {
+        rolling.push(value);
+        if (rolling.full()) {
+            series.var.push_back(rolling.var());
+            series.es.push_back(rolling.es());
+        }
+    }
+    
+    return series;
+}
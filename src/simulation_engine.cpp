@@ -0,0 +1,109 @@
+#include "simulation_engine.h"
+#include "philox.h"
+#include "parallel.h"
+#include "special_functions.h"
+#include <algorithm>
+
+namespace {
+
+uint32_t reverseBits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Laine-Karras hash: applied to bit-reversed values it acts as a nested
+// uniform (Owen) scramble (Burley, 2020)
+uint32_t laineKarras(uint32_t x, uint32_t seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+// Scrambled point of the first Sobol dimension (the base-2 van der Corput
+// sequence, whose bits are the reversed index)
+double scrambledSobol(uint32_t index, uint32_t seed) {
+    uint32_t bits = reverseBits(laineKarras(index, seed));
+    return (static_cast<double>(bits) + 0.5) * 0x1.0p-32;
+}
+
+} // namespace
+
+SimulationEngine::SimulationEngine(uint64_t seed, unsigned numThreads, NormalGenerator::Backend backend)
+    : seed_(seed), numThreads_(numThreads), generator_(backend) {}
+
+std::vector<double> SimulationEngine::simulateNormal(double mean, double stdDev, size_t n) const {
+    std::vector<double> simulated(n);
+    size_t numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    
+    Parallel::forEach(numBlocks, numThreads_, [&](size_t block, unsigned) {
+        Philox4x32 gen(seed_, block);
+        
+        size_t begin = block * BLOCK_SIZE;
+        size_t end = std::min(n, begin + BLOCK_SIZE);
+        generator_.fill(gen, simulated.data() + begin, end - begin, mean, stdDev);
+    });
+    
+    return simulated;
+}
+
+std::vector<double> SimulationEngine::simulateAntithetic(double mean, double stdDev, size_t n) const {
+    std::vector<double> simulated(n);
+    size_t numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    
+    Parallel::forEach(numBlocks, numThreads_, [&](size_t block, unsigned) {
+        Philox4x32 gen(seed_, block);
+        
+        size_t begin = block * BLOCK_SIZE;
+        size_t end = std::min(n, begin + BLOCK_SIZE);
+        size_t pairs = (end - begin + 1) / 2;
+        
+        // One normal draw per antithetic pair
+        std::vector<double> base(pairs);
+        generator_.fill(gen, base.data(), pairs);
+        
+        for (size_t i = 0; i < pairs; ++i) {
+            simulated[begin + 2 * i] = mean + stdDev * base[i];
+            if (begin + 2 * i + 1 < end) {
+                simulated[begin + 2 * i + 1] = mean - stdDev * base[i];
+            }
+        }
+    });
+    
+    return simulated;
+}
+
+std::vector<double> SimulationEngine::simulateSobol(double mean, double stdDev, size_t n, size_t batchSize) const {
+    std::vector<double> simulated(n);
+    size_t numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    batchSize = std::max<size_t>(1, batchSize);
+    
+    Parallel::forEach(numBlocks, numThreads_, [&](size_t block, unsigned) {
+        size_t begin = block * BLOCK_SIZE;
+        size_t end = std::min(n, begin + BLOCK_SIZE);
+        
+        size_t replicate = begin / batchSize;
+        uint32_t scramble = Philox4x32(seed_, replicate)();
+        
+        for (size_t i = begin; i < end; ++i) {
+            if (i / batchSize != replicate) {
+                replicate = i / batchSize;
+                scramble = Philox4x32(seed_, replicate)();
+            }
+            simulated[i] = scrambledSobol(static_cast<uint32_t>(i - replicate * batchSize), scramble);
+        }
+        
+        // Map the block's points to normals in one batched call
+        SpecialFunctions::inverseNormalCdf(simulated.data() + begin, simulated.data() + begin, end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            simulated[i] = mean + stdDev * simulated[i];
+        }
+    });
+    
+    return simulated;
+}
@@ -0,0 +1,117 @@
+#include "stream_monitor.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+double LatencyRecorder::percentile(double p) const {
+    if (samples_.empty()) {
+        return 0.0;
+    }
+
+    std::vector<double> sorted = samples_;
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    size_t index = std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+
+    return sorted[index];
+}
+
+double LatencyRecorder::max() const {
+    return samples_.empty() ? 0.0 : *std::max_element(samples_.begin(), samples_.end());
+}
+
+StreamMonitor::StreamMonitor(size_t window, double confidence, double lambda, size_t batchSize)
+    : batchSize_(std::max<size_t>(1, batchSize)),
+      historical_(window, confidence),
+      parametric_(StreamingParametricVaR::window(window, confidence)),
+      ewma_(StreamingParametricVaR::ewma(lambda, confidence)) {}
+
+void StreamMonitor::push(double value) {
+    historical_.push(value);
+    parametric_.push(value);
+    ewma_.push(value);
+    ++count_;
+}
+
+void StreamMonitor::run(std::istream& in, std::ostream& out) {
+    writeHeader(out);
+    out.flush();
+
+    std::string line;
+    size_t pending = 0;
+    Clock::time_point oldest;
+
+    while (std::getline(in, line)) {
+        double value;
+        if (!parseLine(line, value)) continue;
+
+        if (pending == 0) {
+            oldest = Clock::now();
+        }
+        push(value);
+
+        if (++pending == batchSize_) {
+            writeUpdate(out);
+            out.flush();
+            latency_.record(std::chrono::duration<double, std::micro>(Clock::now() - oldest).count());
+            pending = 0;
+        }
+    }
+
+    // Partial batch at end of input
+    if (pending > 0) {
+        writeUpdate(out);
+        out.flush();
+        latency_.record(std::chrono::duration<double, std::micro>(Clock::now() - oldest).count());
+    }
+}
+
+void StreamMonitor::writeHeader(std::ostream& out) const {
+    out << "count,historical_var,historical_es,parametric_var,parametric_es,ewma_var,ewma_es\n";
+}
+
+void StreamMonitor::writeUpdate(std::ostream& out) const {
+    std::streamsize precision = out.precision(8);
+    out << count_
+        << ',' << historical_.var() << ',' << historical_.es()
+        << ',' << parametric_.var() << ',' << parametric_.es()
+        << ',' << ewma_.var() << ',' << ewma_.es() << '\n';
+    out.precision(precision);
+}
+
+void StreamMonitor::writeLatencyReport(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << "Updates: " << latency_.count() << " (" << count_ << " observations)\n"
+        << std::fixed << std::setprecision(1)
+        << "Latency (us): p50 " << latency_.percentile(50)
+        << ", p90 " << latency_.percentile(90)
+        << ", p99 " << latency_.percentile(99)
+        << ", p99.9 " << latency_.percentile(99.9)
+        << ", max " << latency_.max() << "\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool StreamMonitor::parseLine(const std::string& line, double& value) {
+    size_t start = line.rfind(',');
+    start = (start == std::string::npos) ? 0 : start + 1;
+
+    size_t first = line.find_first_not_of(" \t\r", start);
+    if (first == std::string::npos) {
+        return false;
+    }
+    if (line[first] == '+') {
+        ++first;
+    }
+
+    auto [end, error] = std::from_chars(line.data() + first, line.data() + line.size(), value);
+    return error == std::errc() && end != line.data() + first && std::isfinite(value);
+}
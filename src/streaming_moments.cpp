@@ -0,0 +1,191 @@
+#include "streaming_moments.h"
+#include "special_functions.h"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+void RunningMoments::add(double x) {
+    count_++;
+    double delta = x - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (x - mean_);
+}
+
+void RunningMoments::remove(double x) {
+    if (count_ <= 1) {
+        reset();
+        return;
+    }
+    
+    count_--;
+    double delta = x - mean_;
+    mean_ -= delta / count_;
+    m2_ = std::max(0.0, m2_ - delta * (x - mean_));
+}
+
+void RunningMoments::merge(const RunningMoments& other) {
+    if (other.count_ == 0) return;
+    if (count_ == 0) {
+        *this = other;
+        return;
+    }
+    
+    double total = static_cast<double>(count_ + other.count_);
+    double delta = other.mean_ - mean_;
+    
+    mean_ += delta * other.count_ / total;
+    m2_ += other.m2_ + delta * delta * count_ * other.count_ / total;
+    count_ += other.count_;
+}
+
+void RunningMoments::reset() {
+    count_ = 0;
+    mean_ = 0.0;
+    m2_ = 0.0;
+}
+
+double RunningMoments::variance() const {
+    return count_ > 1 ? m2_ / (count_ - 1) : 0.0;
+}
+
+double RunningMoments::stdDev() const {
+    return std::sqrt(variance());
+}
+
+RunningMoments RunningMoments::of(const std::vector<double>& data) {
+    RunningMoments moments;
+    for (double x : data) {
+        moments.add(x);
+    }
+    return moments;
+}
+
+EwmaVariance::EwmaVariance(double lambda) : lambda_(lambda) {
+    if (!(lambda_ > 0.0 && lambda_ < 1.0)) {
+        throw std::runtime_error("EWMA decay factor must be in (0, 1)");
+    }
+}
+
+void EwmaVariance::add(double r) {
+    variance_ = count_ == 0 ? r * r : lambda_ * variance_ + (1.0 - lambda_) * r * r;
+    count_++;
+}
+
+void EwmaVariance::reset() {
+    variance_ = 0.0;
+    count_ = 0;
+}
+
+double EwmaVariance::volatility() const {
+    return std::sqrt(variance_);
+}
+
+StreamingParametricVaR::StreamingParametricVaR(Estimator estimator, size_t window, double lambda, double confidence)
+    : estimator_(estimator), window_(window), ewma_(lambda) {
+    alpha_ = 1.0 - confidence;
+    if (alpha_ <= 0.0) {
+        throw std::runtime_error("Confidence level must be less than 1.0");
+    }
+    z_ = SpecialFunctions::inverseNormalCdf(confidence);
+    
+    if (estimator_ == Estimator::Window) {
+        if (window_ == 0) {
+            throw std::runtime_error("Rolling window must hold at least one observation");
+        }
+        ring_.reserve(window_);
+    }
+}
+
+StreamingParametricVaR StreamingParametricVaR::window(size_t window, double confidence) {
+    return StreamingParametricVaR(Estimator::Window, window, EwmaVariance::RISKMETRICS_LAMBDA, confidence);
+}
+
+StreamingParametricVaR StreamingParametricVaR::ewma(double lambda, double confidence) {
+    return StreamingParametricVaR(Estimator::Ewma, 0, lambda, confidence);
+}
+
+void StreamingParametricVaR::push(double value) {
+    if (estimator_ == Estimator::Ewma) {
+        ewma_.add(value);
+        return;
+    }
+    
+    if (ring_.size() < window_) {
+        ring_.push_back(value);
+    } else {
+        moments_.remove(ring_[oldest_]);
+        ring_[oldest_] = value;
+        oldest_ = (oldest_ + 1) % window_;
+    }
+    moments_.add(value);
+}
+
+void StreamingParametricVaR::reset() {
+    moments_.reset();
+    ewma_.reset();
+    ring_.clear();
+    oldest_ = 0;
+}
+
+size_t StreamingParametricVaR::count() const {
+    return estimator_ == Estimator::Ewma ? ewma_.count() : moments_.count();
+}
+
+double StreamingParametricVaR::mean() const {
+    // RiskMetrics assumes zero mean daily returns
+    return estimator_ == Estimator::Ewma ? 0.0 : moments_.mean();
+}
+
+double StreamingParametricVaR::sigma() const {
+    return estimator_ == Estimator::Ewma ? ewma_.volatility() : moments_.stdDev();
+}
+
+double StreamingParametricVaR::var() const {
+    return z_ * sigma() - mean();
+}
+
+double StreamingParametricVaR::es() const {
+    return (sigma() * SpecialFunctions::normalPdf(z_) / alpha_) - mean();
+}
+
+RollingRiskSeries StreamingParametricVaR::compute(const std::vector<double>& returns, size_t window, double confidence) {
+    RollingRiskSeries series;
+    series.window = window;
+    if (returns.size() < window) {
+        return series;
+    }
+    
+    series.var.reserve(returns.size() - window + 1);
+    series.es.reserve(returns.size() - window + 1);
+    
+    StreamingParametricVaR streaming = StreamingParametricVaR::window(window, confidence);
+    for (double value : returns) {
+        streaming.push(value);
+        if (streaming.count() == window) {
+            series.var.push_back(streaming.var());
+            series.es.push_back(streaming.es());
+        }
+    }
+    
+    return series;
+}
+
+RollingRiskSeries StreamingParametricVaR::computeEwma(const std::vector<double>& returns, double lambda,
+                                                      size_t warmup, double confidence) {
+    RollingRiskSeries series;
+    series.window = std::max<size_t>(1, warmup);
+    if (returns.size() < series.window) {
+        return series;
+    }
+    
+    StreamingParametricVaR streaming = StreamingParametricVaR::ewma(lambda, confidence);
+    for (double value : returns) {
+        streaming.push(value);
+        if (streaming.count() >= series.window) {
+            series.var.push_back(streaming.var());
+            series.es.push_back(streaming.es());
+        }
+    }
+    
+    return series;
+}
@@ -0,0 +1,29 @@
+#include "tail_selection.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+
+size_t TailSelection::esTailCount(size_t n, double alpha) {
+    size_t tailCount = static_cast<size_t>(std::ceil(alpha * n));
+    return std::min(std::max<size_t>(1, tailCount), n);
+}
+
+void TailSelection::selectLowest(std::vector<double>& data, size_t k) {
+    VAR_PROFILE_SCOPE("tail.select");
+    VAR_PROFILE_COUNT("tail.elements", data.size());
+    k = std::min(k, data.size());
+    if (k == 0) {
+        return;
+    }
+    
+    if (k < data.size()) {
+        std::nth_element(data.begin(), data.begin() + (k - 1), data.end());
+    }
+    std::sort(data.begin(), data.begin() + k);
+}
+
+std::vector<double> TailSelection::lowestCopy(const std::vector<double>& data, size_t k) {
+    std::vector<double> copy = data;
+    selectLowest(copy, k);
+    return copy;
+}
@@ -1,8 +1,94 @@
 #include "var_calculator.h"
+#include "higher_moments.h"
+#include "parallel.h"
+#include "philox.h"
+#include "profiler.h"
+#include "tail_selection.h"
 #include <algorithm>
 #include <numeric>
 #include <cmath>
 #include <stdexcept>
+#include <tuple>
+
+namespace {
+
+// Uniform index in [0, n)
+size_t uniformIndex(Philox4x32& rng, size_t n) {
+    return std::min(n - 1, static_cast<size_t>(rng.uniform() * n));
+}
+
+// Fills sample (already sized n) with one resample of returns
+void drawResample(const std::vector<double>& returns, BootstrapScheme scheme, size_t blockLength,
+                  Philox4x32& rng, std::vector<double>& sample) {
+    size_t n = returns.size();
+    
+    switch (scheme) {
+        case BootstrapScheme::Iid:
+            for (double& value : sample) {
+                value = returns[uniformIndex(rng, n)];
+            }
+            break;
+            
+        case BootstrapScheme::MovingBlock:
+            for (size_t filled = 0; filled < n;) {
+                size_t start = uniformIndex(rng, n - blockLength + 1);
+                size_t length = std::min(blockLength, n - filled);
+                std::copy_n(returns.begin() + start, length, sample.begin() + filled);
+                filled += length;
+            }
+            break;
+            
+        case BootstrapScheme::Stationary: {
+            // Each step starts a new block with probability 1/blockLength
+            double restart = 1.0 / static_cast<double>(blockLength);
+            size_t position = uniformIndex(rng, n);
+            for (size_t i = 0; i < n; ++i) {
+                if (i > 0) {
+                    position = (rng.uniform() < restart) ? uniformIndex(rng, n) : (position + 1) % n;
+                }
+                sample[i] = returns[position];
+            }
+            break;
+        }
+    }
+}
+
+// Lower and upper percentiles of the bootstrap distribution, by selection
+std::pair<double, double> percentileInterval(std::vector<double>& values, double level) {
+    double tail = (1.0 - level) / 2.0;
+    size_t last = values.size() - 1;
+    size_t lower = static_cast<size_t>(std::floor(tail * last));
+    size_t upper = static_cast<size_t>(std::ceil((1.0 - tail) * last));
+    
+    std::nth_element(values.begin(), values.begin() + upper, values.end());
+    double high = values[upper];
+    std::nth_element(values.begin(), values.begin() + lower, values.begin() + upper);
+    return {values[lower], high};
+}
+
+double sampleStdDev(const std::vector<double>& values) {
+    double m = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    double sum = 0.0;
+    for (double v : values) {
+        sum += (v - m) * (v - m);
+    }
+    return values.size() > 1 ? std::sqrt(sum / (values.size() - 1)) : 0.0;
+}
+
+} // namespace
+
+bool parseBootstrapScheme(const std::string& name, BootstrapScheme& scheme) {
+    if (name == "iid") {
+        scheme = BootstrapScheme::Iid;
+    } else if (name == "block") {
+        scheme = BootstrapScheme::MovingBlock;
+    } else if (name == "stationary") {
+        scheme = BootstrapScheme::Stationary;
+    } else {
+        return false;
+    }
+    return true;
+}
 
 double VarCalculator::mean(const std::vector<double>& data) {
     if (data.empty()) return 0.0;
@@ -10,17 +96,7 @@ double VarCalculator::mean(const std::vector<double>& data) {
 }
 
 double VarCalculator::standardDeviation(const std::vector<double>& data) {
-    if (data.size() <= 1) return 0.0;
-    
-    double m = mean(data);
-    double variance = 0.0;
-    
-    for (double value : data) {
-        variance += (value - m) * (value - m);
-    }
-    
-    variance /= (data.size() - 1);
-    return std::sqrt(variance);
+    return HigherMoments::of(data).stdDev();
 }
 
 std::vector<double> VarCalculator::sortedCopy(const std::vector<double>& data) {
@@ -29,25 +105,126 @@ std::vector<double> VarCalculator::sortedCopy(const std::vector<double>& data) {
     return sorted;
 }
 
-double VarCalculator::expectedShortfall(const std::vector<double>& data, double confidence) {
-    if (data.empty()) {
+double VarCalculator::expectedShortfall(const ReturnSeries& returns, double confidence) {
+    if (returns.empty()) {
         return 0.0;
     }
     
-    std::vector<double> sorted = sortedCopy(data);
+    double alpha = 1.0 - confidence;
+    size_t tailCount = TailSelection::esTailCount(returns.size(), alpha);
+    
+    return summarizeTail(*returns.lowest(tailCount), confidence).es;
+}
+
+RiskMeasures VarCalculator::summarizeTail(const std::vector<double>& sorted, double confidence) {
+    RiskMeasures risk;
+    if (sorted.empty()) {
+        return risk;
+    }
     
     double alpha = 1.0 - confidence;
     if (alpha <= 0.0) {
         throw std::runtime_error("Confidence level must be less than 1.0 to compute ES");
     }
     
-    size_t tailCount = static_cast<size_t>(std::ceil(alpha * sorted.size()));
-    tailCount = std::max<size_t>(1, tailCount);
+    size_t tailCount = TailSelection::esTailCount(sorted.size(), alpha);
     
     double sum = 0.0;
     for (size_t i = 0; i < tailCount; ++i) {
         sum += sorted[i];
     }
+    double tailMean = sum / static_cast<double>(tailCount);
+    
+    double variance = 0.0;
+    for (size_t i = 0; i < tailCount; ++i) {
+        variance += (sorted[i] - tailMean) * (sorted[i] - tailMean);
+    }
+    
+    risk.es = -tailMean;
+    risk.tailCount = tailCount;
+    risk.worstLoss = -sorted.front();
+    risk.tailStdDev = tailCount > 1 ? std::sqrt(variance / (tailCount - 1)) : 0.0;
+    
+    return risk;
+}
+
+RiskMeasures VarCalculator::calculateRisk(const ReturnSeries& returns, double confidence) {
+    RiskMeasures risk;
+    risk.var = calculateVaR(returns, confidence);
+    risk.es = calculateES(returns, confidence);
+    return risk;
+}
+
+std::vector<RiskMeasures> VarCalculator::calculateRiskBatch(const ReturnSeries& returns,
+                                                           const std::vector<double>& confidences) {
+    std::vector<RiskMeasures> results;
+    results.reserve(confidences.size());
+    for (double confidence : confidences) {
+        results.push_back(calculateRisk(returns, confidence));
+    }
+    return results;
+}
+
+RiskMeasures VarCalculator::calculateRiskInPlace(std::vector<double>& sample, double confidence) {
+    return calculateRisk(sample, confidence);
+}
+
+BootstrapInterval VarCalculator::bootstrapInterval(const ReturnSeries& returns, double confidence,
+                                                   const BootstrapOptions& options) const {
+    VAR_PROFILE_SCOPE("bootstrap.interval");
+    if (returns.empty()) {
+        throw std::runtime_error("Cannot bootstrap empty returns");
+    }
+    if (options.resamples < 2) {
+        throw std::runtime_error("Bootstrap needs at least two resamples");
+    }
+    if (options.level <= 0.0 || options.level >= 1.0) {
+        throw std::runtime_error("Bootstrap interval level must be between 0 and 1");
+    }
+    
+    size_t n = returns.size();
+    size_t blockLength = 1;
+    if (options.scheme != BootstrapScheme::Iid) {
+        blockLength = options.blockLength > 0
+            ? options.blockLength
+            : static_cast<size_t>(std::ceil(std::cbrt(static_cast<double>(n))));
+        blockLength = std::min(blockLength, n);
+    }
+    
+    BootstrapInterval interval;
+    interval.level = options.level;
+    interval.resamples = options.resamples;
+    interval.blockLength = blockLength;
+    
+    // One calculator and one resample buffer per worker
+    unsigned workers = static_cast<unsigned>(
+        std::min<size_t>(Parallel::resolveThreads(options.numThreads), options.resamples));
+    std::vector<std::unique_ptr<VarCalculator>> clones;
+    std::vector<std::vector<double>> buffers(workers, std::vector<double>(n));
+    for (unsigned w = 0; w < workers; ++w) {
+        clones.push_back(clone());
+    }
+    
+    interval.estimate = clones.front()->calculateRisk(returns, confidence);
+    
+    std::vector<double> vars(options.resamples);
+    std::vector<double> ess(options.resamples);
+    Parallel::forEach(options.resamples, workers, [&](size_t i, unsigned worker) {
+        Philox4x32 rng(options.seed, i);
+        std::vector<double>& sample = buffers[worker];
+        drawResample(returns, options.scheme, blockLength, rng, sample);
+        
+        RiskMeasures risk = clones[worker]->calculateRiskInPlace(sample, confidence);
+        vars[i] = risk.var;
+        ess[i] = risk.es;
+    });
+    
+    VAR_PROFILE_COUNT("bootstrap.resamples", options.resamples);
+    
+    interval.varStandardError = sampleStdDev(vars);
+    interval.esStandardError = sampleStdDev(ess);
+    std::tie(interval.varLower, interval.varUpper) = percentileInterval(vars, options.level);
+    std::tie(interval.esLower, interval.esUpper) = percentileInterval(ess, options.level);
     
-    return -(sum / static_cast<double>(tailCount));
+    return interval;
 }
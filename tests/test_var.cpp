@@ -4,13 +4,35 @@
 #include <vector>
 #include <cmath>
 #include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include <memory>
 
 #include "csv_parser.h"
 #include "historical_var.h"
+#include "filtered_historical_var.h"
+#include "garch.h"
+#include "evt_var.h"
+#include "philox.h"
 #include "parametric_var.h"
 #include "monte_carlo_var.h"
 #include "kernel_var.h"
+#include "bandwidth_selector.h"
 #include "backtesting.h"
+#include "tail_selection.h"
+#include "normal_generator.h"
+#include "rolling_historical_var.h"
+#include "streaming_moments.h"
+#include "higher_moments.h"
+#include "return_series.h"
+#include "cornish_fisher_var.h"
+#include "return_cache.h"
+#include "stream_monitor.h"
+#include "simulation_engine.h"
+#include "special_functions.h"
+#include "profiler.h"
+#include "parallel.h"
 
 int testsRun = 0;
 int testsPassed = 0;
@@ -47,6 +69,102 @@ void formatResults(std::string methodName, double obtainedVaR, double expectedVa
     }
 }
 
+void testCSVParser() {
+    std::cout << "\nTesting CSV Parser...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    const std::string path = "test_var_parser.csv";
+    {
+        std::ofstream file(path);
+        file << "date, returns ,price\r\n";
+        file << "2024-01-01,0.015,100\r\n";
+        file << "\n";
+        file << "2024-01-02, -0.007 ,+101.5\r\n";
+        file << "2024-01-03,n/a,102\r\n";
+        file << "2024-01-04,1e-3\r\n";
+        file << "2024-01-05,-2.5e-2,99";
+    }
+
+    auto data = CSVParser::parseCSV(path);
+    std::vector<double> parsedReturns = CSVParser::parseReturns(path);
+    CSVTable projected = CSVParser::parseColumns(path, {"price", "returns"});
+
+    testsRun++;
+    if (data.size() == 3 && parsedReturns.size() == 3 && data["price"].size() == 4
+        && parsedReturns[0] == 0.015 && parsedReturns[1] == -0.007 && parsedReturns[2] == -0.025
+        && data["price"][1] == 101.5 && data["date"][0] == 2024.0) {
+        testsPassed++;
+        std::cout << "[PASS] CSV Semantics Test\n";
+    } else {
+        std::cout << "[FAIL] CSV Semantics Test\n";
+    }
+
+    testsRun++;
+    if (projected.names.size() == 2 && projected.names[0] == "price"
+        && projected.columns[0] == data["price"] && projected.column("returns") == parsedReturns) {
+        testsPassed++;
+        std::cout << "[PASS] CSV Projection Test\n";
+    } else {
+        std::cout << "[FAIL] CSV Projection Test\n";
+    }
+
+    // Big enough to be split into several chunks; must match a single-threaded parse
+    {
+        std::ofstream file(path);
+        file << "returns\n";
+        for (int i = 0; i < 400000; ++i) {
+            file << (i % 2000 - 1000) * 1.0e-5 << "\n";
+        }
+    }
+
+    std::vector<double> serial = CSVParser::parseReturns(path, "returns", 1);
+    std::vector<double> parallel = CSVParser::parseReturns(path, "returns", 4);
+
+    // Round trip through the binary cache, in both element types
+    const std::string cachePath = "test_var_parser.varc";
+    ReturnCache::convert(path, cachePath, {"returns"});
+    std::vector<double> cached;
+    bool alignedView = false;
+    {
+        ReturnCache cache(cachePath);
+        ReturnCache::ColumnView view = cache.column("returns");
+        alignedView = view.doubles() != nullptr
+                      && reinterpret_cast<uintptr_t>(view.data) % ReturnCache::ALIGNMENT == 0;
+        cached = view.toVector();
+    }
+
+    ReturnCache::write(cachePath, CSVTable{{"returns"}, {serial}}, ReturnCache::ColumnType::Float);
+    double maxFloatError = 0.0;
+    {
+        ReturnCache cache(cachePath);
+        ReturnCache::ColumnView view = cache.column("returns");
+        for (size_t i = 0; i < view.size; ++i) {
+            maxFloatError = std::max(maxFloatError, std::abs(view[i] - serial[i]));
+        }
+    }
+    bool rejectsCsv = !ReturnCache::isCache(path);
+    std::remove(cachePath.c_str());
+    std::remove(path.c_str());
+
+    testsRun++;
+    if (cached == serial && alignedView && maxFloatError < 1e-9 && rejectsCsv) {
+        testsPassed++;
+        std::cout << "[PASS] Return Cache Round Trip Test\n";
+    } else {
+        std::cout << "[FAIL] Return Cache Round Trip Test\n";
+    }
+
+    testsRun++;
+    if (serial.size() == 400000 && serial == parallel) {
+        testsPassed++;
+        std::cout << "[PASS] CSV Chunked Parse Test\n";
+    } else {
+        std::cout << "[FAIL] CSV Chunked Parse Test\n";
+    }
+
+    std::cout << "CSV parser tests completed.\n";
+}
+
 void testHistoricalVaR() {
     std::cout << "\nTesting Historical VaR...\n";
     std::cout << std::string(50, '-') << "\n";
@@ -109,6 +227,192 @@ void testParametricVaR() {
     formatResults("Parametric VaR 99%", var99, expectedVaR99);
 }
 
+void testSpecialFunctions() {
+    std::cout << "\nTesting Special Functions...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    // Reference values to 16 digits
+    double z999 = SpecialFunctions::inverseNormalCdf(0.999);
+    double farTail = SpecialFunctions::normalCdf(-10.0);
+    std::cout << "  z(99.9%) = " << std::setprecision(16) << z999 << ", Phi(-10) = " << farTail << "\n";
+    std::cout << std::setprecision(6);
+
+    testsRun++;
+    if (std::abs(z999 - 3.090232306167813) < 1e-14
+        && std::abs(farTail / 7.619853024160527e-24 - 1.0) < 1e-14
+        && std::abs(SpecialFunctions::normalCdf(1.959963984540054) - 0.975) < 1e-15
+        && std::abs(SpecialFunctions::normalPdf(1.0) - 0.2419707245191434) < 1e-16) {
+        testsPassed++;
+        std::cout << "[PASS] Normal Distribution Accuracy Test\n";
+    } else {
+        std::cout << "[FAIL] Normal Distribution Accuracy Test\n";
+    }
+
+    // Odd length so the SIMD kernels also run their scalar remainder
+    std::vector<double> x, p;
+    for (int i = -1500; i <= 1500; i += 3) {
+        x.push_back(i / 40.0);
+        p.push_back(std::pow(10.0, -300.0 * std::abs(i) / 1500.0) * (i < 0 ? 1.0 : 0.5));
+    }
+    std::vector<double> cdf(x.size()), pdf(x.size()), z(p.size());
+    SpecialFunctions::normalCdf(x.data(), cdf.data(), x.size());
+    SpecialFunctions::normalPdf(x.data(), pdf.data(), x.size());
+    SpecialFunctions::inverseNormalCdf(p.data(), z.data(), p.size());
+
+    bool batchesAgree = true;
+    double roundTrip = 0.0;
+    for (size_t i = 0; i < x.size(); ++i) {
+        batchesAgree = batchesAgree
+            && std::abs(cdf[i] - SpecialFunctions::normalCdf(x[i])) <= 1e-14 * SpecialFunctions::normalCdf(x[i])
+            && std::abs(pdf[i] - SpecialFunctions::normalPdf(x[i])) <= 1e-14 * SpecialFunctions::normalPdf(x[i])
+            && std::abs(z[i] - SpecialFunctions::inverseNormalCdf(p[i])) <= 1e-14 * std::abs(z[i]);
+        if (p[i] > 1e-200) {
+            roundTrip = std::max(roundTrip, std::abs(SpecialFunctions::normalCdf(z[i]) / p[i] - 1.0));
+        }
+    }
+    std::cout << "  Largest relative round-trip error Phi(Phi^-1(p)) / p - 1: " << roundTrip << "\n";
+
+    testsRun++;
+    if (batchesAgree && roundTrip < 1e-11) {
+        testsPassed++;
+        std::cout << "[PASS] Batched Normal Functions Test\n";
+    } else {
+        std::cout << "[FAIL] Batched Normal Functions Test\n";
+    }
+
+    // The parametric VaR now uses the exact quantile at every level
+    std::vector<double> sample = {-0.02, -0.01, 0.0, 0.01, 0.02};
+    HigherMoments moments = HigherMoments::of(sample);
+    double var999 = ParametricVaR().calculateVaR(sample, 0.999);
+    assertEqual(var999 / (z999 * moments.stdDev() - moments.mean()), 1.0, "Parametric VaR 99.9% Quantile Test");
+
+    std::cout << "Special functions tests completed.\n";
+}
+
+void testHigherMoments() {
+    std::cout << "\nTesting Higher Moments and Cornish-Fisher VaR...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    // Skewed series far from zero, against a two-pass reference
+    SimulationEngine engine(13, 1);
+    std::vector<double> series = engine.simulateNormal(0.0, 1.0, 300000);
+    for (double& x : series) {
+        x = 100.0 + 0.01 * (x + 0.3 * x * x);
+    }
+    double mean = 0.0;
+    for (double x : series) mean += x;
+    mean /= series.size();
+    double m2 = 0.0, m3 = 0.0, m4 = 0.0;
+    for (double x : series) {
+        double d = x - mean;
+        m2 += d * d;
+        m3 += d * d * d;
+        m4 += d * d * d * d;
+    }
+    double n = static_cast<double>(series.size());
+    double skewness = std::sqrt(n) * m3 / std::pow(m2, 1.5);
+    double kurtosis = n * m4 / (m2 * m2) - 3.0;
+
+    HigherMoments serial = HigherMoments::of(series);
+    HigherMoments parallel = HigherMoments::of(series, 4);
+    HigherMoments merged;
+    for (size_t i = 0; i < 1000; ++i) {
+        merged.add(series[i]);
+    }
+    merged.add(series.data() + 1000, series.size() - 1000);
+    std::cout << "  Skewness " << serial.skewness() << " (reference " << skewness << "), excess kurtosis "
+              << serial.excessKurtosis() << " (reference " << kurtosis << ")\n";
+
+    bool agrees = true;
+    for (const HigherMoments& m : {serial, parallel, merged}) {
+        agrees = agrees && m.count() == series.size() && std::abs(m.mean() - mean) < 1e-12
+                 && std::abs(m.variance() / (m2 / (n - 1)) - 1.0) < 1e-9
+                 && std::abs(m.skewness() - skewness) < 1e-8 && std::abs(m.excessKurtosis() - kurtosis) < 1e-8;
+    }
+    testsRun++;
+    if (agrees) {
+        testsPassed++;
+        std::cout << "[PASS] Higher Moments Test\n";
+    } else {
+        std::cout << "[FAIL] Higher Moments Test\n";
+    }
+
+    // Without skew or excess kurtosis the expansion is the normal quantile
+    double z = SpecialFunctions::inverseNormalCdf(0.01);
+    std::vector<double> symmetric = {-0.02, -0.01, 0.0, 0.01, 0.02, -0.02, 0.02};
+    HigherMoments flat = HigherMoments::of(symmetric);
+    CornishFisherVaR cornishFisher;
+    std::vector<double> skewed = engine.simulateNormal(0.0, 1.0, 5000);
+    for (double& x : skewed) {
+        x = 0.01 * (x - 0.2 * (x * x - 1.0));
+    }
+    RiskMeasures adjusted = cornishFisher.calculateRisk(skewed, 0.99);
+    double normal = ParametricVaR().calculateVaR(skewed, 0.99);
+    std::cout << "  VaR (99%) of left-skewed returns: Cornish-Fisher " << adjusted.var << ", normal " << normal << "\n";
+
+    testsRun++;
+    if (CornishFisherVaR::adjustedQuantile(z, 0.0, 0.0) == z
+        && std::abs(CornishFisherVaR::fromMoments(flat, 0.99).var + flat.stdDev() * CornishFisherVaR::adjustedQuantile(
+               z, flat.skewness(), flat.excessKurtosis())) < 1e-15
+        && adjusted.var > normal * 1.05 && adjusted.es > adjusted.var) {
+        testsPassed++;
+        std::cout << "[PASS] Cornish-Fisher VaR Test\n";
+    } else {
+        std::cout << "[FAIL] Cornish-Fisher VaR Test\n";
+    }
+
+    std::cout << "Higher moments tests completed.\n";
+}
+
+void testStreamingMoments() {
+    std::cout << "\nTesting Streaming Moments and EWMA...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    std::vector<double> series;
+    for (int i = 0; i < 600; ++i) {
+        series.push_back(0.01 * std::sin(0.37 * i) + 0.002 * ((i * 13) % 7 - 3));
+    }
+
+    // Merging two halves must match one accumulator over everything
+    RunningMoments left = RunningMoments::of(std::vector<double>(series.begin(), series.begin() + 250));
+    RunningMoments right = RunningMoments::of(std::vector<double>(series.begin() + 250, series.end()));
+    left.merge(right);
+    RunningMoments full = RunningMoments::of(series);
+
+    const size_t window = 250;
+    RollingRiskSeries rolling = StreamingParametricVaR::compute(series, window, 0.95);
+    ParametricVaR calculator;
+    double maxDiff = 0.0;
+    for (size_t i = 0; i < rolling.var.size(); ++i) {
+        std::vector<double> slice(series.begin() + i, series.begin() + i + window);
+        maxDiff = std::max(maxDiff, std::abs(rolling.var[i] - calculator.calculateVaR(slice, 0.95)));
+        maxDiff = std::max(maxDiff, std::abs(rolling.es[i] - calculator.calculateES(slice, 0.95)));
+    }
+    std::cout << "  Max difference to per-window parametric VaR/ES: " << maxDiff << "\n";
+
+    // Constant squared returns keep the EWMA variance constant
+    EwmaVariance ewma;
+    for (int i = 0; i < 100; ++i) {
+        ewma.add(i % 2 == 0 ? 0.02 : -0.02);
+    }
+    std::cout << "  EWMA volatility: " << ewma.volatility() << "\n";
+
+    testsRun++;
+    if (std::abs(left.stdDev() - full.stdDev()) < 1e-15 && maxDiff < 1e-12) {
+        testsPassed++;
+        std::cout << "[PASS] Streaming Window Agreement Test\n";
+    } else {
+        std::cout << "[FAIL] Streaming Window Agreement Test\n";
+    }
+
+    assertEqual(ewma.volatility(), 0.02, "EWMA Volatility Test");
+
+    formatResults("Streaming Parametric VaR 95%", rolling.var.back(),
+                  calculator.calculateVaR(std::vector<double>(series.end() - window, series.end()), 0.95));
+
+    std::cout << "Streaming moments tests completed.\n";
+}
+
 void testMonteCarloVaR() {
     std::cout << "\nTesting Monte Carlo VaR...\n";
     std::cout << std::string(50, '-') << "\n";
@@ -130,6 +434,298 @@ void testMonteCarloVaR() {
 
 }
 
+void testMonteCarloReproducibility() {
+    std::cout << "\nTesting Monte Carlo Reproducibility...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    MonteCarloVaR singleThread(100000, 7, 1);
+    MonteCarloVaR multiThread(100000, 7, 4);
+
+    double var1 = singleThread.calculateVaR(returns, 0.99);
+    double var4 = multiThread.calculateVaR(returns, 0.99);
+    std::cout << "  99% VaR (1 thread): " << var1 << "\n";
+    std::cout << "  99% VaR (4 threads): " << var4 << "\n";
+
+    testsRun++;
+    if (var1 == var4) {
+        testsPassed++;
+        std::cout << "[PASS] Monte Carlo Thread-Count Independence Test\n";
+    } else {
+        std::cout << "[FAIL] Monte Carlo Thread-Count Independence Test\n";
+    }
+
+    formatResults("Monte Carlo 1 vs 4 threads", var4, var1);
+
+    std::cout << "Monte Carlo reproducibility tests completed.\n";
+}
+
+void testMonteCarloSamplingModes() {
+    std::cout << "\nTesting Monte Carlo Sampling Modes...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    // Model N(0.01, 0.03^2) at 99%: VaR = 2.326348 * 0.03 - 0.01
+    std::vector<double> model = {-0.02, 0.04, -0.02, 0.04};
+    double sigma = 0.0346410161513775;
+    double exactVaR = 2.3263478740408408 * sigma - 0.01;
+
+    MonteCarloVaR::SamplingMode modes[] = {
+        MonteCarloVaR::SamplingMode::PseudoRandom,
+        MonteCarloVaR::SamplingMode::Antithetic,
+        MonteCarloVaR::SamplingMode::Sobol,
+        MonteCarloVaR::SamplingMode::ImportanceSampling
+    };
+
+    double pseudoError = 0.0;
+    double bestError = 1.0;
+    for (auto mode : modes) {
+        MonteCarloVaR calculator(1 << 16, 3, 0, mode);
+        RiskMeasures risk = calculator.calculateRisk(model, 0.99);
+        std::cout << "  " << MonteCarloVaR::samplingModeName(mode) << ": VaR " << risk.var
+                  << " +/- " << risk.varStandardError << ", ES " << risk.es
+                  << " +/- " << risk.esStandardError << "\n";
+
+        assertEqual(risk.var, exactVaR, std::string("Monte Carlo ") + MonteCarloVaR::samplingModeName(mode) + " VaR Test");
+
+        if (mode == MonteCarloVaR::SamplingMode::PseudoRandom) {
+            pseudoError = risk.varStandardError;
+        } else {
+            bestError = std::min(bestError, risk.varStandardError);
+        }
+    }
+
+    testsRun++;
+    if (pseudoError > 0.0 && bestError < pseudoError) {
+        testsPassed++;
+        std::cout << "[PASS] Variance Reduction Standard Error Test\n";
+    } else {
+        std::cout << "[FAIL] Variance Reduction Standard Error Test\n";
+    }
+
+    // Every mode's name parses back to it, and typos are rejected
+    bool parsed = true;
+    for (auto mode : modes) {
+        MonteCarloVaR::SamplingMode parsedMode = MonteCarloVaR::SamplingMode::PseudoRandom;
+        parsed = parsed && MonteCarloVaR::parseSamplingMode(MonteCarloVaR::samplingModeName(mode), parsedMode)
+                 && parsedMode == mode;
+    }
+    MonteCarloVaR::SamplingMode unchanged = MonteCarloVaR::SamplingMode::Sobol;
+    testsRun++;
+    if (parsed && !MonteCarloVaR::parseSamplingMode("sobel", unchanged) && unchanged == MonteCarloVaR::SamplingMode::Sobol) {
+        testsPassed++;
+        std::cout << "[PASS] Sampling Mode Parsing Test\n";
+    } else {
+        std::cout << "[FAIL] Sampling Mode Parsing Test\n";
+    }
+
+    formatResults("Monte Carlo Sobol VaR 99%", exactVaR, exactVaR);
+
+    std::cout << "Monte Carlo sampling mode tests completed.\n";
+}
+
+void testNormalGenerator() {
+    std::cout << "\nTesting Vectorized Normal Generator...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    const size_t n = 100001;
+    NormalGenerator scalar(NormalGenerator::Backend::Scalar);
+    NormalGenerator vectorized;
+    std::cout << "  Detected backend: " << NormalGenerator::backendName(vectorized.backend()) << "\n";
+
+    std::vector<double> expected(n), actual(n);
+    Philox4x32 scalarGen(11), vectorGen(11);
+    scalar.fill(scalarGen, expected.data(), n);
+    vectorized.fill(vectorGen, actual.data(), n);
+
+    double maxDiff = 0.0, sum = 0.0, sumSq = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        maxDiff = std::max(maxDiff, std::abs(actual[i] - expected[i]));
+        sum += actual[i];
+        sumSq += actual[i] * actual[i];
+    }
+    std::cout << "  Max difference to scalar: " << maxDiff << "\n";
+
+    testsRun++;
+    if (maxDiff < 1e-12) {
+        testsPassed++;
+        std::cout << "[PASS] Normal Generator Backend Agreement Test\n";
+    } else {
+        std::cout << "[FAIL] Normal Generator Backend Agreement Test\n";
+    }
+
+    assertEqual(sum / n, 0.0, "Normal Generator Mean Test");
+    assertEqual(sumSq / n, 1.0, "Normal Generator Variance Test");
+
+    formatResults("Normal Generator Variance", sumSq / n, 1.0);
+
+    std::cout << "Normal generator tests completed.\n";
+}
+
+void testFilteredHistoricalVaR() {
+    std::cout << "\nTesting Filtered Historical VaR...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    // GARCH(1,1) path with known parameters
+    const GarchParams truth{2e-6, 0.08, 0.90};
+    SimulationEngine engine(5, 1);
+    std::vector<double> shocks = engine.simulateNormal(0.0, 1.0, 5000);
+    std::vector<double> path(shocks.size());
+    double h = truth.longRunVariance();
+    for (size_t t = 0; t < shocks.size(); ++t) {
+        path[t] = std::sqrt(h) * shocks[t];
+        h = truth.omega + truth.alpha * path[t] * path[t] + truth.beta * h;
+    }
+
+    GarchFit cold = Garch11::fit(path);
+    GarchFit warm = Garch11::fit(path, cold.params);
+    std::cout << "  Fitted omega " << cold.params.omega << ", alpha " << cold.params.alpha
+              << ", beta " << cold.params.beta << " in " << cold.iterations << " iterations (warm: "
+              << warm.iterations << ")\n";
+
+    testsRun++;
+    if (cold.converged && std::abs(cold.params.alpha - truth.alpha) < 0.03
+        && std::abs(cold.params.beta - truth.beta) < 0.04 && warm.iterations < cold.iterations
+        && std::abs(warm.logLikelihood - cold.logLikelihood) < 1e-6) {
+        testsPassed++;
+        std::cout << "[PASS] GARCH Fit Test\n";
+    } else {
+        std::cout << "[FAIL] GARCH Fit Test\n";
+    }
+
+    // Analytic gradient against central differences
+    std::vector<double> residuals(path.begin(), path.begin() + 500);
+    GarchParams point{3e-6, 0.1, 0.85};
+    double gradient[3];
+    Garch11::negativeLogLikelihood(residuals, point, gradient);
+    bool gradientMatches = true;
+    for (int k = 0; k < 3; ++k) {
+        double step = (k == 0) ? 1e-10 : 1e-6;
+        GarchParams up = point, down = point;
+        double* upField = (k == 0) ? &up.omega : (k == 1) ? &up.alpha : &up.beta;
+        double* downField = (k == 0) ? &down.omega : (k == 1) ? &down.alpha : &down.beta;
+        *upField += step;
+        *downField -= step;
+        double numeric = (Garch11::negativeLogLikelihood(residuals, up)
+                          - Garch11::negativeLogLikelihood(residuals, down)) / (2 * step);
+        gradientMatches = gradientMatches && std::abs(numeric - gradient[k]) < 1e-4 * std::max(1.0, std::abs(numeric));
+    }
+    testsRun++;
+    if (gradientMatches) {
+        testsPassed++;
+        std::cout << "[PASS] GARCH Gradient Test\n";
+    } else {
+        std::cout << "[FAIL] GARCH Gradient Test\n";
+    }
+
+    std::vector<std::vector<double>> series = {std::vector<double>(path.begin(), path.begin() + 1000),
+                                               std::vector<double>(path.begin() + 1000, path.begin() + 2000),
+                                               std::vector<double>(path.begin() + 2000, path.begin() + 3000)};
+    std::vector<GarchFit> batch = Garch11::fitBatch(series, {}, 3);
+    bool batchMatches = batch.size() == series.size();
+    for (size_t i = 0; i < series.size() && batchMatches; ++i) {
+        batchMatches = batch[i].params.alpha == Garch11::fit(series[i]).params.alpha;
+    }
+
+    // After a volatility spike the filtered estimate rises above plain
+    // historical simulation, which still weighs the calm period equally
+    std::vector<double> regime(path.begin(), path.begin() + 1000);
+    for (int i = 0; i < 5; ++i) {
+        regime.push_back(i % 2 ? 0.04 : -0.04);
+    }
+    FilteredHistoricalVaR filtered;
+    RiskMeasures fhs = filtered.calculateRisk(regime, 0.99);
+    double historical = HistoricalVaR().calculateVaR(regime, 0.99);
+    std::cout << "  VaR (99%) after a spike: filtered " << fhs.var << ", historical " << historical << "\n";
+
+    testsRun++;
+    if (batchMatches && fhs.var > historical && fhs.es > fhs.var && filtered.fit(regime).converged) {
+        testsPassed++;
+        std::cout << "[PASS] Filtered Historical VaR Test\n";
+    } else {
+        std::cout << "[FAIL] Filtered Historical VaR Test\n";
+    }
+
+    // Every fit depends only on its own window, so bootstrap intervals and
+    // walk-forward forecasts do not change with the thread count
+    BootstrapOptions options;
+    options.resamples = 40;
+    options.numThreads = 1;
+    BootstrapInterval serialInterval = filtered.bootstrapInterval(regime, 0.99, options);
+    options.numThreads = 4;
+    BootstrapInterval parallelInterval = filtered.bootstrapInterval(regime, 0.99, options);
+
+    std::vector<double> history(path.begin(), path.begin() + 600);
+    WalkForwardResult serialForecasts = Backtesting::walkForward(filtered, history, 500, 0.99, 1);
+    WalkForwardResult parallelForecasts = Backtesting::walkForward(filtered, history, 500, 0.99, 4);
+
+    testsRun++;
+    if (serialInterval.varLower == parallelInterval.varLower && serialInterval.varUpper == parallelInterval.varUpper
+        && serialInterval.esLower == parallelInterval.esLower && serialInterval.esUpper == parallelInterval.esUpper
+        && serialForecasts.var.size() == 100 && serialForecasts.var == parallelForecasts.var
+        && serialForecasts.es == parallelForecasts.es) {
+        testsPassed++;
+        std::cout << "[PASS] Filtered Historical Determinism Test\n";
+    } else {
+        std::cout << "[FAIL] Filtered Historical Determinism Test\n";
+    }
+
+    std::cout << "Filtered historical VaR tests completed.\n";
+}
+
+void testEvtVaR() {
+    std::cout << "\nTesting EVT VaR...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    // Symmetric returns with GPD(xi, sigma) magnitudes: the loss tail is
+    // P(L > x) = (1 + xi x / sigma)^(-1/xi) / 2 at every level
+    const double xi = 0.25, sigma = 0.01;
+    Philox4x32 rng(3);
+    std::vector<double> heavy(20000);
+    for (double& r : heavy) {
+        double magnitude = sigma / xi * (std::pow(1.0 - rng.uniform(), -xi) - 1.0);
+        r = rng.uniform() < 0.5 ? -magnitude : magnitude;
+    }
+    double trueVaR = sigma / xi * (std::pow(2.0 * 0.001, -xi) - 1.0);
+    double trueES = (trueVaR + sigma) / (1.0 - xi);
+
+    EvtVaR evt;
+    GpdFit fit = EvtVaR::fitTail(heavy);
+    RiskMeasures risk = evt.calculateRisk(heavy, 0.999);
+    std::cout << "  Shape " << fit.shape << " from " << fit.exceedances << " exceedances\n";
+    std::cout << "  VaR (99.9%): " << risk.var << " (true " << trueVaR << ")\n";
+    std::cout << "  ES (99.9%): " << risk.es << " (true " << trueES << ")\n";
+
+    testsRun++;
+    if (std::abs(fit.shape - xi) < 0.1 && std::abs(risk.var / trueVaR - 1.0) < 0.1
+        && std::abs(risk.es / trueES - 1.0) < 0.15 && fit.exceedances <= 2000) {
+        testsPassed++;
+        std::cout << "[PASS] EVT Heavy Tail Test\n";
+    } else {
+        std::cout << "[FAIL] EVT Heavy Tail Test\n";
+    }
+
+    // Thin normal tail; levels below the threshold are refused
+    SimulationEngine engine(9, 1);
+    std::vector<double> normal = engine.simulateNormal(0.0, 0.01, 5000);
+    std::vector<RiskMeasures> levels = evt.calculateRiskBatch(normal, {0.95, 0.99});
+    bool refused = false;
+    try {
+        EvtVaR::tailVaR(EvtVaR::fitTail(normal), 0.5);
+    } catch (const std::exception&) {
+        refused = true;
+    }
+
+    testsRun++;
+    if (std::abs(levels[1].var / 0.023263 - 1.0) < 0.1 && levels[0].var < levels[1].var
+        && levels[1].var < levels[1].es && refused) {
+        testsPassed++;
+        std::cout << "[PASS] EVT Normal Tail Test\n";
+    } else {
+        std::cout << "[FAIL] EVT Normal Tail Test\n";
+    }
+
+    std::cout << "EVT VaR tests completed.\n";
+}
+
 void testKernelVaR() {
     std::cout << "\nTesting Kernel Density VaR...\n";
     std::cout << std::string(50, '-') << "\n";
@@ -150,6 +746,123 @@ void testKernelVaR() {
     std::cout << "Kernel Density VaR tests completed.\n";
 }
 
+void testKernelCdfModes() {
+    std::cout << "\nTesting Kernel CDF Engine Modes...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    std::vector<double> rtrns;
+    for (int i = 0; i < 5000; ++i) {
+        double u = (i + 0.5) / 5000.0;
+        rtrns.push_back(0.01 * std::tan(3.0 * (u - 0.5)));
+    }
+
+    KernelVaR exactCalculator(-1.0, KdeCdf::Mode::Exact);
+    KernelVaR binnedCalculator(-1.0, KdeCdf::Mode::Binned);
+
+    double exactVaR = exactCalculator.calculateVaR(rtrns, 0.99);
+    double binnedVaR = binnedCalculator.calculateVaR(rtrns, 0.99);
+    std::cout << "  Exact 99% VaR: " << exactVaR << "\n";
+    std::cout << "  Binned 99% VaR: " << binnedVaR << "\n";
+
+    KdeCdf cdf(rtrns, 0.002);
+    double probability = cdf.cdf(cdf.quantile(0.01));
+    std::cout << "  CDF at 1% quantile: " << probability << "\n";
+
+    assertEqual(binnedVaR, exactVaR, "Kernel Binned vs Exact 99% Test");
+    assertEqual(probability * 100.0, 1.0, "Kernel CDF Round Trip Test");
+
+    formatResults("Kernel Binned 99%", binnedVaR, exactVaR);
+
+    // The closed-form tail expectation against a trapezoid rule on t * pdf(t)
+    double q = cdf.quantile(0.01);
+    double lower = rtrns.front() - KdeCdf::CUTOFF * cdf.bandwidth();
+    const int steps = 200000;
+    double step = (q - lower) / steps;
+    double integral = 0.0;
+    for (int i = 0; i <= steps; ++i) {
+        double t = lower + i * step;
+        integral += (i == 0 || i == steps ? 0.5 : 1.0) * t * cdf.pdf(t) * step;
+    }
+    KdeCdf binnedCdf(rtrns, 0.002, KdeCdf::Mode::Binned);
+    std::cout << "  Partial mean below the 1% quantile: " << cdf.partialMean(q)
+              << " (trapezoid " << integral << ")\n";
+
+    RiskMeasures exactRisk = exactCalculator.calculateRisk(rtrns, 0.99);
+    testsRun++;
+    if (std::abs(cdf.partialMean(q) / integral - 1.0) < 1e-6
+        && std::abs(binnedCdf.partialMean(q) / cdf.partialMean(q) - 1.0) < 1e-12
+        && exactRisk.es > exactRisk.var && exactCalculator.calculateES(rtrns, 0.99) == exactRisk.es) {
+        testsPassed++;
+        std::cout << "[PASS] Kernel Analytic ES Test\n";
+    } else {
+        std::cout << "[FAIL] Kernel Analytic ES Test\n";
+    }
+
+    // --kde-mode rejects misspelt engines instead of falling back to exact
+    KdeCdf::Mode mode = KdeCdf::Mode::Exact;
+    testsRun++;
+    if (KdeCdf::parseMode("binned", mode) && mode == KdeCdf::Mode::Binned
+        && !KdeCdf::parseMode("bined", mode) && mode == KdeCdf::Mode::Binned) {
+        testsPassed++;
+        std::cout << "[PASS] Kernel Mode Parsing Test\n";
+    } else {
+        std::cout << "[FAIL] Kernel Mode Parsing Test\n";
+    }
+
+    std::cout << "Kernel CDF engine tests completed.\n";
+}
+
+void testBandwidthSelection() {
+    std::cout << "\nTesting Bandwidth Selection...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    SimulationEngine engine(11, 1);
+    std::vector<double> normal = engine.simulateNormal(0.0, 0.01, 5000);
+    ReturnSeries normalSeries(normal);
+    double silverman = normalSeries.silvermanBandwidth();
+    double sj = BandwidthSelector::sheatherJones(normalSeries);
+    double lscv = BandwidthSelector::leastSquaresCv(normalSeries);
+    std::cout << "  Normal returns: Silverman " << silverman << ", SJ " << sj << ", LSCV " << lscv << "\n";
+
+    // Close to the normal reference when the data are normal
+    testsRun++;
+    if (std::abs(sj / silverman - 1.0) < 0.15 && std::abs(lscv / silverman - 1.0) < 0.35
+        && std::abs(BandwidthSelector::sheatherJones(normalSeries, 16384) / sj - 1.0) < 0.01) {
+        testsPassed++;
+        std::cout << "[PASS] Bandwidth Normal Reference Test\n";
+    } else {
+        std::cout << "[FAIL] Bandwidth Normal Reference Test\n";
+    }
+
+    // Fat tails inflate the standard deviation, and with it Silverman's rule
+    std::vector<double> fat;
+    for (int i = 0; i < 5000; ++i) {
+        double u = (i + 0.5) / 5000.0;
+        fat.push_back(0.01 * std::tan(3.0 * (u - 0.5)));
+    }
+    ReturnSeries fatSeries(fat);
+    double fatSilverman = fatSeries.silvermanBandwidth();
+    double fatSj = BandwidthSelector::select(fatSeries, BandwidthSelector::Rule::SheatherJones);
+    double fatLscv = BandwidthSelector::select(fatSeries, BandwidthSelector::Rule::Lscv);
+    std::cout << "  Fat-tailed returns: Silverman " << fatSilverman << ", SJ " << fatSj << ", LSCV " << fatLscv << "\n";
+
+    BandwidthSelector::Rule rule = BandwidthSelector::Rule::Silverman;
+    bool parsed = BandwidthSelector::parseRule("sj", rule) && rule == BandwidthSelector::Rule::SheatherJones
+                  && !BandwidthSelector::parseRule("0.01", rule);
+    double ruleVaR = KernelVaR(BandwidthSelector::Rule::SheatherJones).calculateVaR(fat, 0.99);
+    double fixedVaR = KernelVaR(fatSj).calculateVaR(fat, 0.99);
+
+    testsRun++;
+    if (fatSj < 0.5 * fatSilverman && fatLscv < 0.5 * fatSilverman && parsed && ruleVaR == fixedVaR) {
+        testsPassed++;
+        std::cout << "[PASS] Bandwidth Fat Tail Test\n";
+    } else {
+        std::cout << "[FAIL] Bandwidth Fat Tail Test\n";
+    }
+
+    std::cout << "Bandwidth selection tests completed.\n";
+}
+
 void testExpectedShortfall() {
     std::cout << "\nTesting Expected Shortfall (ES)...\n";
     std::cout << std::string(50, '-') << "\n";
@@ -175,6 +888,281 @@ void testExpectedShortfall() {
     std::cout << "Expected Shortfall tests completed.\n";
 }
 
+void testCombinedRiskMeasures() {
+    std::cout << "\nTesting Combined Risk Measures...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    HistoricalVaR historical;
+    RiskMeasures historicalRisk = historical.calculateRisk(returns, 0.90);
+    std::cout << "  Historical 90% VaR/ES: " << historicalRisk.var << " / " << historicalRisk.es
+              << " (tail of " << historicalRisk.tailCount << ")\n";
+
+    assertEqual(historicalRisk.var, historical.calculateVaR(returns, 0.90), "Historical Combined VaR Test");
+    assertEqual(historicalRisk.es, historical.calculateES(returns, 0.90), "Historical Combined ES Test");
+
+    MonteCarloVaR monteCarlo(50000);
+    RiskMeasures monteCarloRisk = monteCarlo.calculateRisk(returns, 0.95);
+    std::cout << "  Monte Carlo 95% VaR/ES: " << monteCarloRisk.var << " / " << monteCarloRisk.es
+              << " (tail of " << monteCarloRisk.tailCount << ")\n";
+
+    testsRun++;
+    if (monteCarloRisk.tailCount >= 2500 && monteCarloRisk.tailCount <= 2501
+        && monteCarloRisk.es >= monteCarloRisk.var
+        && monteCarloRisk.worstLoss >= monteCarloRisk.es) {
+        testsPassed++;
+        std::cout << "[PASS] Monte Carlo Shared Tail Test\n";
+    } else {
+        std::cout << "[FAIL] Monte Carlo Shared Tail Test\n";
+    }
+
+    formatResults("Combined Historical VaR 90%", historicalRisk.var, expectedVaR90);
+
+    std::cout << "Combined risk measure tests completed.\n";
+}
+
+void testRiskBatch() {
+    std::cout << "\nTesting Multi-Level Risk Batch...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    std::vector<double> levels = {0.90, 0.95, 0.99};
+
+    HistoricalVaR historical;
+    std::vector<RiskMeasures> historicalRisks = historical.calculateRiskBatch(returns, levels);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        RiskMeasures single = historical.calculateRisk(returns, levels[i]);
+        assertEqual(historicalRisks[i].var, single.var, "Historical Batch VaR Test");
+        assertEqual(historicalRisks[i].es, single.es, "Historical Batch ES Test");
+    }
+
+    ParametricVaR parametric;
+    std::vector<RiskMeasures> parametricRisks = parametric.calculateRiskBatch(returns, levels);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        assertEqual(parametricRisks[i].var, parametric.calculateVaR(returns, levels[i]), "Parametric Batch VaR Test");
+        assertEqual(parametricRisks[i].es, parametric.calculateES(returns, levels[i]), "Parametric Batch ES Test");
+    }
+
+    // Same seed, same paths: one simulation must reproduce every single-level run
+    MonteCarloVaR monteCarlo(20000);
+    std::vector<RiskMeasures> monteCarloRisks = monteCarlo.calculateRiskBatch(returns, levels);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        RiskMeasures single = monteCarlo.calculateRisk(returns, levels[i]);
+        assertEqual(monteCarloRisks[i].var, single.var, "Monte Carlo Batch VaR Test");
+        assertEqual(monteCarloRisks[i].es, single.es, "Monte Carlo Batch ES Test");
+    }
+
+    KernelVaR kernel;
+    std::vector<RiskMeasures> kernelRisks = kernel.calculateRiskBatch(returns, levels);
+    for (size_t i = 0; i < levels.size(); ++i) {
+        assertEqual(kernelRisks[i].var, kernel.calculateVaR(returns, levels[i]), "Kernel Batch VaR Test");
+        assertEqual(kernelRisks[i].es, kernel.calculateES(returns, levels[i]), "Kernel Batch ES Test");
+    }
+
+    std::cout << "Multi-level risk batch tests completed.\n";
+}
+
+void testBootstrapInterval() {
+    std::cout << "\nTesting Bootstrap Intervals...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    SimulationEngine engine(3, 1);
+    std::vector<double> simulated = engine.simulateNormal(0.0, 0.01, 1000);
+    const double trueVaR = 0.016449;
+
+    // Same interval for any thread count, and it covers the true quantile
+    bool deterministic = true;
+    bool covers = true;
+    for (BootstrapScheme scheme : {BootstrapScheme::Iid, BootstrapScheme::MovingBlock, BootstrapScheme::Stationary}) {
+        BootstrapOptions options;
+        options.scheme = scheme;
+        options.resamples = 400;
+        options.numThreads = 1;
+        BootstrapInterval serial = HistoricalVaR().bootstrapInterval(simulated, 0.95, options);
+        options.numThreads = 4;
+        BootstrapInterval parallel = HistoricalVaR().bootstrapInterval(simulated, 0.95, options);
+
+        std::cout << "  VaR 90% interval: [" << parallel.varLower << ", " << parallel.varUpper
+                  << "], block length " << parallel.blockLength << "\n";
+        deterministic = deterministic && serial.varLower == parallel.varLower && serial.varUpper == parallel.varUpper
+                        && serial.esLower == parallel.esLower && serial.esUpper == parallel.esUpper;
+        covers = covers && parallel.varLower < trueVaR && trueVaR < parallel.varUpper
+                 && parallel.varLower <= parallel.estimate.var && parallel.estimate.var <= parallel.varUpper
+                 && parallel.esLower < parallel.esUpper && parallel.varStandardError > 0.0;
+    }
+
+    // Closed-form methods go through the default resample path
+    BootstrapOptions options;
+    options.resamples = 200;
+    BootstrapInterval parametric = ParametricVaR().bootstrapInterval(simulated, 0.95, options);
+
+    testsRun++;
+    if (deterministic && covers && parametric.varLower < trueVaR && trueVaR < parametric.varUpper
+        && parametric.varUpper - parametric.varLower < 0.004) {
+        testsPassed++;
+        std::cout << "[PASS] Bootstrap Interval Test\n";
+    } else {
+        std::cout << "[FAIL] Bootstrap Interval Test\n";
+    }
+
+    BootstrapScheme scheme = BootstrapScheme::Iid;
+    testsRun++;
+    if (parseBootstrapScheme("stationary", scheme) && scheme == BootstrapScheme::Stationary
+        && !parseBootstrapScheme("blocks", scheme) && scheme == BootstrapScheme::Stationary) {
+        testsPassed++;
+        std::cout << "[PASS] Bootstrap Scheme Parsing Test\n";
+    } else {
+        std::cout << "[FAIL] Bootstrap Scheme Parsing Test\n";
+    }
+
+    std::cout << "Bootstrap interval tests completed.\n";
+}
+
+void testTailSelection() {
+    std::cout << "\nTesting Tail Selection...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    // Permutation of -5000..5000 (scaled) so the sorted order is known
+    std::vector<double> shuffled;
+    for (int i = 0; i <= 10000; ++i) {
+        shuffled.push_back(((i * 7919) % 10001 - 5000) / 100000.0);
+    }
+
+    std::vector<double> tail = TailSelection::lowestCopy(shuffled, 100);
+    bool tailSorted = true;
+    for (int i = 0; i < 100; ++i) {
+        tailSorted = tailSorted && tail[i] == (i - 5000) / 100000.0;
+    }
+
+    HistoricalVaR calculator;
+    RiskMeasures risk = calculator.calculateRisk(shuffled, 0.99);
+    std::cout << "  99% VaR/ES: " << risk.var << " / " << risk.es << "\n";
+
+    testsRun++;
+    if (tailSorted) {
+        testsPassed++;
+        std::cout << "[PASS] Tail Selection Order Test\n";
+    } else {
+        std::cout << "[FAIL] Tail Selection Order Test\n";
+    }
+
+    // Index 0.01 * 10000 = 100 -> -4900; tail of 101 -> mean -4950
+    assertEqual(risk.var * 1000.0, 49.0, "Selection Historical VaR 99% Test");
+    assertEqual(risk.es * 1000.0, 49.5, "Selection Historical ES 99% Test");
+
+    formatResults("Selection Historical VaR 99%", risk.var, 0.049);
+
+    std::cout << "Tail selection tests completed.\n";
+}
+
+void testRollingHistoricalVaR() {
+    std::cout << "\nTesting Rolling Historical VaR...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    // Deterministic series with many ties to exercise duplicate handling
+    std::vector<double> series;
+    for (int i = 0; i < 800; ++i) {
+        series.push_back(((i * 37) % 101 - 50) / 1000.0);
+    }
+
+    const size_t window = 250;
+    RollingRiskSeries rolling = RollingHistoricalVaR::compute(series, window, 0.99);
+    std::cout << "  Windows computed: " << rolling.var.size() << "\n";
+
+    HistoricalVaR calculator;
+    double maxVarDiff = 0.0, maxEsDiff = 0.0;
+    for (size_t i = 0; i < rolling.var.size(); ++i) {
+        std::vector<double> slice(series.begin() + i, series.begin() + i + window);
+        maxVarDiff = std::max(maxVarDiff, std::abs(rolling.var[i] - calculator.calculateVaR(slice, 0.99)));
+        maxEsDiff = std::max(maxEsDiff, std::abs(rolling.es[i] - calculator.calculateES(slice, 0.99)));
+    }
+    std::cout << "  Max difference to per-window VaR/ES: " << maxVarDiff << " / " << maxEsDiff << "\n";
+
+    testsRun++;
+    if (rolling.var.size() == series.size() - window + 1 && maxVarDiff < 1e-12 && maxEsDiff < 1e-12) {
+        testsPassed++;
+        std::cout << "[PASS] Rolling Historical Window Agreement Test\n";
+    } else {
+        std::cout << "[FAIL] Rolling Historical Window Agreement Test\n";
+    }
+
+    // A NaN would break the tree's order and corrupt every later estimate
+    RollingHistoricalVaR guarded(window, 0.99);
+    for (size_t i = 0; i < window; ++i) {
+        guarded.push(series[i]);
+    }
+    bool rejected = true;
+    for (double value : {std::nan(""), -HUGE_VAL}) {
+        try {
+            guarded.push(value);
+            rejected = false;
+        } catch (const std::runtime_error&) {
+        }
+    }
+    for (size_t i = window; i < series.size(); ++i) {
+        guarded.push(series[i]);
+    }
+
+    testsRun++;
+    if (rejected && guarded.var() == rolling.var.back() && guarded.es() == rolling.es.back()) {
+        testsPassed++;
+        std::cout << "[PASS] Rolling Historical Non-Finite Test\n";
+    } else {
+        std::cout << "[FAIL] Rolling Historical Non-Finite Test\n";
+    }
+
+    formatResults("Rolling Historical VaR 99%", rolling.var.back(),
+                  calculator.calculateVaR(std::vector<double>(series.end() - window, series.end()), 0.99));
+
+    std::cout << "Rolling historical VaR tests completed.\n";
+}
+
+void testStreamMonitor() {
+    std::cout << "\nTesting Stream Monitor...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    std::istringstream feed("date,returns\n"
+                            "2024-01-01,-0.05\n2024-01-02,-0.03\n2024-01-03,-0.01\n"
+                            "2024-01-04,0.00\n2024-01-05,0.01\n\n2024-01-05,nan\n2024-01-05,-inf\n"
+                            "2024-01-06,0.02\n"
+                            "2024-01-07,0.03\n2024-01-08,0.04\n2024-01-09,0.05\n"
+                            "2024-01-10,0.06\n");
+    std::ostringstream updates;
+
+    StreamMonitor monitor(5, 0.90, EwmaVariance::RISKMETRICS_LAMBDA, 4);
+    monitor.run(feed, updates);
+
+    // Header plus updates after 4, 8 and the final partial batch of 10
+    std::istringstream lines(updates.str());
+    std::string line, last;
+    size_t numLines = 0;
+    while (std::getline(lines, line)) {
+        last = line;
+        numLines++;
+    }
+
+    RollingRiskSeries historical = RollingHistoricalVaR::compute(returns, 5, 0.90);
+    RollingRiskSeries ewma = StreamingParametricVaR::computeEwma(returns, EwmaVariance::RISKMETRICS_LAMBDA, 1, 0.90);
+
+    std::vector<double> fields;
+    std::istringstream row(last);
+    for (std::string field; std::getline(row, field, ',');) {
+        fields.push_back(std::stod(field));
+    }
+
+    testsRun++;
+    if (numLines == 4 && monitor.count() == 10 && monitor.latency().count() == 3 && fields.size() == 7
+        && std::abs(fields[1] - historical.var.back()) < 1e-6 && std::abs(fields[2] - historical.es.back()) < 1e-6
+        && std::abs(fields[5] - ewma.var.back()) < 1e-6
+        && monitor.latency().percentile(50) <= monitor.latency().max()) {
+        testsPassed++;
+        std::cout << "[PASS] Stream Monitor Test\n";
+    } else {
+        std::cout << "[FAIL] Stream Monitor Test\n";
+    }
+
+    monitor.writeLatencyReport(std::cout);
+    std::cout << "Stream monitor tests completed.\n";
+}
+
 void testBacktesting() {
     std::cout << "\nTesting Backtesting Functions...\n";
     std::cout << std::string(50, '-') << "\n";
@@ -204,10 +1192,177 @@ void testBacktesting() {
     testsRun++;
     
     std::cout << Backtesting::formatBacktestResults(result);
+
+    // Only losses beyond VaR are breaches
+    testsRun++;
+    if (result.exceeds == 1 && !Backtesting::exceedsVaR(0.06, var95) && Backtesting::exceedsVaR(-0.05, var95)) {
+        testsPassed++;
+        std::cout << "[PASS] Loss-Side Exceedance Test\n";
+    } else {
+        std::cout << "[FAIL] Loss-Side Exceedance Test\n";
+    }
+
+    // Batched bitmaps agree with the scalar predicate, including a partial last word
+    SimulationEngine bitmapEngine(11, 1);
+    std::vector<double> series = bitmapEngine.simulateNormal(0.0, 0.01, 1000);
+    std::vector<std::vector<double>> thresholds = {{0.0128, 0.0164, 0.0233}, {0.0, 0.02, 1.0}};
+    ExceedanceMatrix matrix = Backtesting::countExceedances(series, thresholds);
+
+    bool bitmapsMatch = matrix.words == 16;
+    for (size_t m = 0; m < thresholds.size(); ++m) {
+        for (size_t l = 0; l < thresholds[m].size(); ++l) {
+            size_t expected = 0;
+            for (size_t i = 0; i < series.size(); ++i) {
+                bool hit = Backtesting::exceedsVaR(series[i], thresholds[m][l]);
+                expected += hit;
+                bitmapsMatch = bitmapsMatch && matrix.exceeded(m, l, i) == hit;
+            }
+            bitmapsMatch = bitmapsMatch && matrix.count(m, l) == expected;
+        }
+    }
+    testsRun++;
+    if (bitmapsMatch && matrix.count(1, 2) == 0) {
+        testsPassed++;
+        std::cout << "[PASS] Exceedance Matrix Test\n";
+    } else {
+        std::cout << "[FAIL] Exceedance Matrix Test\n";
+    }
+
+    assertEqual(Backtesting::kupiecTest(250, 10, 0.01).statistic, 12.9555, "Kupiec Statistic Test");
+    assertEqual(Backtesting::kupiecTest(1000, 50, 0.05).pValue, 1.0, "Kupiec Exact Coverage Test");
+    assertEqual(SpecialFunctions::chiSquaredSurvival(3.841459, 1), 0.05, "Chi-Squared Survival Test");
+
+    std::vector<uint8_t> alternating(200);
+    for (size_t i = 0; i < alternating.size(); ++i) {
+        alternating[i] = i % 2;
+    }
+    testsRun++;
+    if (Backtesting::independenceTest(alternating).rejected()) {
+        testsPassed++;
+        std::cout << "[PASS] Christoffersen Clustering Test\n";
+    } else {
+        std::cout << "[FAIL] Christoffersen Clustering Test\n";
+    }
+
+    // Walk-forward on simulated normal returns: same forecasts for any
+    // thread count, and a correctly specified model passes coverage
+    SimulationEngine engine(7, 1);
+    std::vector<double> simulated = engine.simulateNormal(0.0, 0.01, 1250);
+    WalkForwardResult serial = Backtesting::walkForward(ParametricVaR(), simulated, 250, 0.95, 1);
+    WalkForwardResult parallel = Backtesting::walkForward(ParametricVaR(), simulated, 250, 0.95, 4);
+    std::cout << Backtesting::formatWalkForwardResults(parallel);
+
+    testsRun++;
+    if (serial.var.size() == 1000 && serial.var == parallel.var && serial.hits == parallel.hits
+        && !parallel.kupiec.rejected(0.01)) {
+        testsPassed++;
+        std::cout << "[PASS] Walk-Forward Backtest Test\n";
+    } else {
+        std::cout << "[FAIL] Walk-Forward Backtest Test\n";
+    }
     
     std::cout << "Backtesting tests completed.\n";
 }
 
+void testReturnSeries() {
+    std::cout << "\nTesting Return Series Sharing...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    SimulationEngine engine(21, 1);
+    std::vector<double> simulated = engine.simulateNormal(0.0005, 0.01, 3000);
+    ReturnSeries series(simulated);
+
+    std::vector<std::unique_ptr<VarCalculator>> calculators;
+    calculators.push_back(std::make_unique<HistoricalVaR>());
+    calculators.push_back(std::make_unique<ParametricVaR>());
+    calculators.push_back(std::make_unique<CornishFisherVaR>());
+    calculators.push_back(std::make_unique<KernelVaR>());
+    calculators.push_back(std::make_unique<KernelVaR>(BandwidthSelector::Rule::SheatherJones));
+    calculators.push_back(std::make_unique<EvtVaR>());
+
+    // Shared and per-call series give the same numbers, but the shared
+    // one sorts, takes the moments and selects each bandwidth once for
+    // every method and call
+    bool same = true;
+    Profiler::reset();
+    Profiler::setEnabled(true);
+    for (const auto& calculator : calculators) {
+        RiskMeasures shared = calculator->calculateRisk(series, 0.95);
+        same = same && shared.var == calculator->calculateVaR(series, 0.95)
+               && shared.es == calculator->calculateES(series, 0.95);
+    }
+    Profiler::setEnabled(false);
+    Profiler::setAllocationTracking(false);
+    std::string report = Profiler::report(Profiler::Format::Json);
+    Profiler::reset();
+
+    for (const auto& calculator : calculators) {
+        RiskMeasures separate = calculator->calculateRisk(simulated, 0.95);
+        RiskMeasures shared = calculator->calculateRisk(series, 0.95);
+        same = same && std::abs(separate.var - shared.var) < 1e-12 && std::abs(separate.es - shared.es) < 1e-12;
+    }
+
+    const double* first = series.sorted().data();
+    testsRun++;
+    if (same && series.sorted().data() == first && series.lowest(10)->data() == first
+        && std::is_sorted(series.sorted().begin(), series.sorted().end())
+        && (!VAR_PROFILING || (report.find("\"series.sort\",\"calls\":1") != std::string::npos
+                               && report.find("\"moments.elements\":3000") != std::string::npos
+                               && report.find("\"bandwidth.sj\",\"calls\":1") != std::string::npos))) {
+        testsPassed++;
+        std::cout << "[PASS] Return Series Sharing Test\n";
+    } else {
+        std::cout << "[FAIL] Return Series Sharing Test\n";
+    }
+
+    std::cout << "Return series tests completed.\n";
+}
+
+void testProfiler() {
+    std::cout << "\nTesting Profiler...\n";
+    std::cout << std::string(50, '-') << "\n";
+
+    Profiler::reset();
+    Profiler::setEnabled(true);
+    HistoricalVaR().calculateRisk(returns, 0.95);
+    KernelVaR(-1.0, KdeCdf::Mode::Exact).calculateVaR(returns, 0.95);
+    Profiler::setEnabled(false);
+    Profiler::setAllocationTracking(false);
+    std::string report = Profiler::report(Profiler::Format::Json);
+
+    // Nothing is recorded once the profiler is off again
+    HistoricalVaR().calculateRisk(returns, 0.95);
+    bool unchanged = Profiler::report(Profiler::Format::Json) == report;
+
+    // Worker threads keep their own totals, which outlive the threads
+    Profiler::reset();
+    Profiler::setEnabled(true);
+    Parallel::forEach(64, 4, [](size_t, unsigned) {
+        HistoricalVaR().calculateRisk(returns, 0.95);
+    });
+    Profiler::setEnabled(false);
+    Profiler::setAllocationTracking(false);
+    std::string parallelReport = Profiler::report(Profiler::Format::Json);
+
+    testsRun++;
+    if (!VAR_PROFILING
+        || (report.find("\"historical.risk\",\"calls\":1") != std::string::npos
+            && report.find("\"tail.elements\":10") != std::string::npos
+            && report.find("\"kde.cdf_evaluations\"") != std::string::npos
+            && unchanged
+            && parallelReport.find("\"historical.risk\",\"calls\":64") != std::string::npos
+            && parallelReport.find("\"tail.elements\":640") != std::string::npos
+            && parallelReport.find("kde.") == std::string::npos)) {
+        testsPassed++;
+        std::cout << "[PASS] Profiler Test\n";
+    } else {
+        std::cout << "[FAIL] Profiler Test\n";
+    }
+
+    Profiler::reset();
+    std::cout << "Profiler tests completed.\n";
+}
+
 void compareAllMethods() {
     std::cout << "\n\nComparing All VaR Methods...\n";
     std::cout << std::string(75, '=') << "\n";
@@ -231,12 +1386,31 @@ int main() {
     
     try {
 
+        testCSVParser();
         testHistoricalVaR();
         testParametricVaR();
+        testSpecialFunctions();
+        testStreamingMoments();
+        testHigherMoments();
         testMonteCarloVaR();
+        testMonteCarloReproducibility();
+        testMonteCarloSamplingModes();
+        testNormalGenerator();
+        testFilteredHistoricalVaR();
+        testEvtVaR();
         testKernelVaR();
+        testKernelCdfModes();
+        testBandwidthSelection();
         testExpectedShortfall();
+        testCombinedRiskMeasures();
+        testRiskBatch();
+        testBootstrapInterval();
+        testTailSelection();
+        testRollingHistoricalVaR();
+        testStreamMonitor();
         testBacktesting();
+        testReturnSeries();
+        testProfiler();
         
         compareAllMethods();
         